@@ -19,7 +19,8 @@ struct arena {
 
 #define DEFAULT_STORAGE_SIZE 8
 
-static arena *current_arena;
+//each thread builds its own arena so instances can be created in parallel
+static __thread arena *current_arena;
 
 arena *get_current_arena()
 {
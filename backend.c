@@ -5,6 +5,7 @@
 */
 #include "backend.h"
 #include <stdlib.h>
+#include <string.h>
 
 deferred_addr * defer_address(deferred_addr * old_head, uint32_t address, uint8_t *dest)
 {
@@ -816,3 +817,50 @@ use_map:
 	*data_out = (void *)chunk;
 	return interp_write_map_8;
 }
+
+void set_code_flush_point(cpu_options *opts)
+{
+	if (!opts->code.pool) {
+		start_code_pool(&opts->code);
+	}
+	//everything emitted before this point (fixed helper routines) survives a flush
+	opts->flush_point = opts->code;
+	opts->flush_chunk = code_pool_mark(&opts->code);
+}
+
+uint8_t code_flush_needed(cpu_options *opts)
+{
+	if (!opts->code.pool || opts->deferred) {
+		return 0;
+	}
+	if (opts->translated_bytes >= CODE_FLUSH_MAX_SIZE) {
+		return 1;
+	}
+	return opts->translated_bytes >= CODE_FLUSH_MIN_SIZE && opts->dead_bytes >= opts->translated_bytes / 2;
+}
+
+void flush_code(cpu_options *opts, void *context, uint32_t map_chunks)
+{
+	for (uint32_t chunk = 0; chunk < map_chunks; chunk++)
+	{
+		if (opts->native_code_map[chunk].base) {
+			free(opts->native_code_map[chunk].offsets);
+			opts->native_code_map[chunk].base = NULL;
+			opts->native_code_map[chunk].offsets = NULL;
+		}
+	}
+	uint32_t ram = ram_size(opts);
+	for (uint32_t i = 0; i < ram / 1024; i++)
+	{
+		free(opts->ram_inst_sizes[i]);
+		opts->ram_inst_sizes[i] = NULL;
+	}
+	memset((uint8_t *)context + opts->ram_flags_off, 0, ram / (1 << opts->ram_flags_shift) / 8);
+	opts->code = opts->flush_point;
+	code_pool_rewind(&opts->code, opts->flush_chunk);
+	opts->code_generation++;
+	opts->translated_bytes = opts->dead_bytes = 0;
+	if (opts->code_flushed) {
+		opts->code_flushed(context);
+	}
+}
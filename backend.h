@@ -13,6 +13,10 @@
 #define INVALID_OFFSET 0xFFFFFFFF
 #define EXTENSION_WORD 0xFFFFFFFE
 #define CYCLE_NEVER 0xFFFFFFFF
+//translated code is thrown away once this much has been generated and at least half of it is dead
+#define CODE_FLUSH_MIN_SIZE (4*CODE_ALLOC_SIZE)
+//or once this much has been generated regardless of how much of it is still live
+#define CODE_FLUSH_MAX_SIZE (32*CODE_ALLOC_SIZE)
 
 #if defined(X86_32) || defined(X86_64)
 typedef struct {
@@ -45,12 +49,15 @@ typedef struct deferred_addr {
 
 typedef void * (*watchpoint16_fun)(uint32_t address, void * context, uint16_t);
 typedef void * (*watchpoint8_fun)(uint32_t address, void * context, uint8_t);
+//called by flush_code so each CPU core can drop any native code pointers it keeps outside the code map
+typedef void (*code_flush_fun)(void *context);
 
 typedef struct {
 	uint32_t flags;
 	native_map_slot    *native_code_map;
 	deferred_addr      *deferred;
 	code_info          code;
+	code_info          flush_point;
 	uint8_t            **ram_inst_sizes;
 	memmap_chunk const *memmap;
 	code_ptr           save_context;
@@ -62,14 +69,20 @@ typedef struct {
 	code_ptr           handle_align_error_read;
 	watchpoint16_fun   check_watchpoints_16;
 	watchpoint8_fun    check_watchpoints_8;
+	code_flush_fun     code_flushed;
 	system_str_fun_r8  debug_cmd_handler;
 	uint32_t           memmap_chunks;
 	uint32_t           address_mask;
 	uint32_t           max_address;
 	uint32_t           bus_cycles;
 	uint32_t           clock_divider;
+	uint32_t           flush_chunk;
+	uint32_t           code_generation;
+	uint32_t           translated_bytes;
+	uint32_t           dead_bytes;
 	uint32_t           move_pc_off;
 	uint32_t           move_pc_size;
+	uint32_t           cycle_batch; //cycles counted instead of emitted while batch_cycles is set
 	int32_t            watchpoint_range_off;
 	int32_t            mem_ptr_off;
 	int32_t            ram_flags_off;
@@ -82,6 +95,7 @@ typedef struct {
 	int8_t             scratch1;
 	int8_t             scratch2;
 	uint8_t            align_error_mask;
+	uint8_t            batch_cycles;
 } cpu_options;
 
 typedef void (*debug_handler)(void *context, uint32_t pc);
@@ -121,6 +135,9 @@ void write_byte(uint32_t address, uint8_t value, void **mem_pointers, cpu_option
 memmap_chunk const *find_map_chunk(uint32_t address, cpu_options *opts, uint16_t flags, uint32_t *size_sum);
 uint32_t chunk_size(cpu_options *opts, memmap_chunk const *chunk);
 uint32_t ram_size(cpu_options *opts);
+void set_code_flush_point(cpu_options *opts);
+uint8_t code_flush_needed(cpu_options *opts);
+void flush_code(cpu_options *opts, void *context, uint32_t map_chunks);
 interp_read_16 get_interp_read_16(void *context, cpu_options *opts, uint32_t start, uint32_t end, void **data_out);
 interp_read_8 get_interp_read_8(void *context, cpu_options *opts, uint32_t start, uint32_t end, void **data_out);
 interp_write_16 get_interp_write_16(void *context, cpu_options *opts, uint32_t start, uint32_t end, void **data_out);
@@ -4,6 +4,11 @@
 
 void cycles(cpu_options *opts, uint32_t num)
 {
+	if (opts->batch_cycles) {
+		//caller emits a single adjustment for the whole batch
+		opts->cycle_batch += num*opts->clock_divider;
+		return;
+	}
 	if (opts->limit < 0) {
 		sub_ir(&opts->code, num*opts->clock_divider, opts->cycles, SZ_D);
 	} else {
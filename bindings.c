@@ -48,7 +48,8 @@ typedef enum {
 	UI_COMPOSITE_DEBUG,
 	UI_OSCILLOSCOPE_DEBUG,
 	UI_CD_GRAPHICS_DEBUG,
-	UI_PASTE
+	UI_PASTE,
+	UI_REWIND
 } ui_action;
 
 typedef struct {
@@ -232,6 +233,10 @@ void handle_binding_down(keybinding * binding)
 	{
 		current_system->mouse_down(current_system, binding->subtype_a, binding->subtype_b);
 	}
+	else if (binding->bind_type == BIND_UI && binding->subtype_a == UI_REWIND)
+	{
+		system_set_rewinding(current_system, 1);
+	}
 }
 
 static uint8_t keyboard_captured;
@@ -510,6 +515,11 @@ void handle_binding_up(keybinding * binding)
 				current_system->paste_cur_char = 0;
 			}
 			break;
+		case UI_REWIND:
+			if (current_system) {
+				system_set_rewinding(current_system, 0);
+			}
+			break;
 		}
 		break;
 	}
@@ -748,6 +758,8 @@ int parse_binding_target(int device_num, const char * target, tern_node * padbut
 			*subtype_a = UI_CD_GRAPHICS_DEBUG;
 		} else if (!strcmp(target + 3, "paste")) {
 			*subtype_a = UI_PASTE;
+		} else if (!strcmp(target + 3, "rewind")) {
+			*subtype_a = UI_REWIND;
 		} else {
 			warning("Unreconized UI binding type %s\n", target);
 			return 0;
@@ -136,10 +136,11 @@ void setup_saves(system_media *media, system_header *context)
 		|| (context->type == SYSTEM_GENESIS && info->wants_cd)
 	) {
 		context->load_save(context);
-		if (!persist_save_registered) {
-			atexit(persist_save);
-			persist_save_registered = 1;
-		}
+	}
+	//registered even without save memory as persist_save also writes out the code cache
+	if (!persist_save_registered) {
+		atexit(persist_save);
+		persist_save_registered = 1;
 	}
 }
 
@@ -355,6 +356,8 @@ void init_system_with_media(char *path, system_type force_stype)
 	}
 	game_system->next_context = menu_system;
 	setup_saves(&cart, game_system);
+	system_init_rewind(game_system);
+	system_init_runahead(game_system);
 	update_title(game_system->info.name);
 }
 
@@ -648,6 +651,8 @@ int main(int argc, char ** argv)
 			menu_system = current_system;
 		} else {
 			game_system = current_system;
+			system_init_rewind(game_system);
+			system_init_runahead(game_system);
 		}
 	}
 
@@ -8,6 +8,7 @@ void cdd_fader_init(cdd_fader *fader)
 	fader->cur_attenuation = 0x4000;
 	fader->dst_attenuation = 0x4000;
 	fader->attenuation_step = 0;
+	fader->block_frames = 0;
 }
 
 void cdd_fader_deinit(cdd_fader *fader)
@@ -58,7 +59,11 @@ void cdd_fader_data(cdd_fader *fader, uint8_t byte)
 			//TODO: FIXME
 			left = right = 0;
 		}
-		render_put_stereo_sample(fader->audio, left, right);
+		fader->block[fader->block_frames * 2] = left;
+		fader->block[fader->block_frames * 2 + 1] = right;
+		if (++fader->block_frames == AUDIO_BLOCK_FRAMES) {
+			cdd_fader_flush(fader);
+		}
 		if (fader->attenuation_step) {
 			if (fader->dst_attenuation > fader->cur_attenuation) {
 				fader->cur_attenuation += fader->attenuation_step;
@@ -77,6 +82,13 @@ void cdd_fader_data(cdd_fader *fader, uint8_t byte)
 	}
 }
 
+//samples are collected in a block, this needs to be called whenever the CDD is done running
+void cdd_fader_flush(cdd_fader *fader)
+{
+	render_put_stereo_block(fader->audio, fader->block, fader->block_frames);
+	fader->block_frames = 0;
+}
+
 void cdd_fader_serialize(cdd_fader *fader, serialize_buffer *buf)
 {
 	save_int16(buf, fader->cur_attenuation);
@@ -6,6 +6,8 @@
 
 typedef struct {
 	audio_source *audio;
+	uint32_t     block_frames;
+	int16_t      block[AUDIO_BLOCK_FRAMES * 2];
 	uint16_t     cur_attenuation;
 	uint16_t     dst_attenuation;
 	uint16_t     attenuation_step;
@@ -19,6 +21,7 @@ void cdd_fader_deinit(cdd_fader *fader);
 void cdd_fader_set_speed_percent(cdd_fader *fader, uint32_t percent);
 void cdd_fader_attenuation_write(cdd_fader *fader, uint16_t attenuation);
 void cdd_fader_data(cdd_fader *fader, uint8_t byte);
+void cdd_fader_flush(cdd_fader *fader);
 void cdd_fader_pause(cdd_fader *fader);
 void cdd_fader_serialize(cdd_fader *fader, serialize_buffer *buf);
 void cdd_fader_deserialize(deserialize_buffer *buf, void *vfader);
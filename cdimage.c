@@ -1,6 +1,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "system.h"
 #include "util.h"
@@ -93,6 +94,315 @@ enum {
 	FAKE_AUDIO,
 };
 
+//Track data is read a whole sector (subcodes included) at a time into a small LRU cache
+//A worker thread loads the sectors following the last seek so sequential reads rarely touch the disk
+#define SECTOR_CACHE_ENTRIES 32
+#define SECTOR_READ_AHEAD 8
+#define MAX_SECTOR_BYTES (2352 + 96)
+
+enum {
+	SECTOR_EMPTY,
+	SECTOR_LOADING,
+	SECTOR_READY
+};
+
+struct cd_sector_cache {
+	uint8_t         data[SECTOR_CACHE_ENTRIES][MAX_SECTOR_BYTES];
+	uint32_t        track[SECTOR_CACHE_ENTRIES];
+	uint32_t        sector[SECTOR_CACHE_ENTRIES];
+	uint32_t        last_used[SECTOR_CACHE_ENTRIES];
+	uint8_t         state[SECTOR_CACHE_ENTRIES];
+	uint8_t         *cur_data; //entry reads are currently served from, never evicted
+	uint32_t        cur_entry;
+	uint32_t        cur_track;
+	uint32_t        cur_start;
+	uint32_t        cur_end;
+	uint32_t        use_counter;
+	uint32_t        ahead_track;
+	uint32_t        ahead_sector;
+	uint32_t        ahead_end;
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_mutex_t io_lock;
+	pthread_cond_t  work_cond;
+	pthread_cond_t  done_cond;
+	uint8_t         has_thread;
+	uint8_t         quit;
+};
+
+static cd_sector_cache *get_sector_cache(system_media *media)
+{
+	if (!media->sector_cache) {
+		cd_sector_cache *cache = calloc(1, sizeof(cd_sector_cache));
+		cache->cur_entry = SECTOR_CACHE_ENTRIES;
+		pthread_mutex_init(&cache->lock, NULL);
+		pthread_mutex_init(&cache->io_lock, NULL);
+		pthread_cond_init(&cache->work_cond, NULL);
+		pthread_cond_init(&cache->done_cond, NULL);
+		media->sector_cache = cache;
+	}
+	return media->sector_cache;
+}
+
+//must be called with the cache lock held
+static int find_sector(cd_sector_cache *cache, uint32_t track, uint32_t sector)
+{
+	for (int i = 0; i < SECTOR_CACHE_ENTRIES; i++)
+	{
+		if (cache->state[i] != SECTOR_EMPTY && cache->track[i] == track && cache->sector[i] == sector) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//must be called with the cache lock held, picks the least recently used entry that isn't in use
+static int claim_sector(cd_sector_cache *cache, uint32_t track, uint32_t sector)
+{
+	int victim = -1;
+	for (int i = 0; i < SECTOR_CACHE_ENTRIES; i++)
+	{
+		if (cache->state[i] == SECTOR_LOADING || i == cache->cur_entry) {
+			continue;
+		}
+		if (victim < 0 || cache->last_used[i] < cache->last_used[victim]) {
+			victim = i;
+		}
+	}
+	cache->state[victim] = SECTOR_LOADING;
+	cache->track[victim] = track;
+	cache->sector[victim] = sector;
+	cache->last_used[victim] = ++cache->use_counter;
+	return victim;
+}
+
+static void load_sector(system_media *media, uint32_t track, uint32_t sector, uint8_t *dst)
+{
+	cd_sector_cache *cache = media->sector_cache;
+	track_info *info = media->tracks + track;
+	uint32_t start = info->file_offset + sector * info->sector_bytes;
+	pthread_mutex_lock(&cache->io_lock);
+	if (info->flac) {
+		uint64_t sample = start / 4;
+		if (sample < info->flac->total_samples) {
+			flac_seek(info->flac, sample);
+		}
+		for (uint32_t i = 0; i < info->sector_bytes; i += 4, sample++)
+		{
+			//anything past the end of the stream is silence
+			int16_t samples[2] = {0, 0};
+			if (sample < info->flac->total_samples) {
+				flac_get_sample(info->flac, samples, 2);
+			}
+			dst[i] = samples[0];
+			dst[i + 1] = samples[0] >> 8;
+			dst[i + 2] = samples[1];
+			dst[i + 3] = samples[1] >> 8;
+		}
+	} else {
+		size_t bytes = 0;
+		if (!fseek(info->f, start, SEEK_SET)) {
+			bytes = fread(dst, 1, info->sector_bytes, info->f);
+		}
+		//bytes past the end of the file read as EOF did with fgetc
+		memset(dst + bytes, 0xFF, info->sector_bytes - bytes);
+	}
+	pthread_mutex_unlock(&cache->io_lock);
+}
+
+static void *read_ahead_worker(void *data)
+{
+	system_media *media = data;
+	cd_sector_cache *cache = media->sector_cache;
+	pthread_mutex_lock(&cache->lock);
+	for (;;)
+	{
+		while (cache->ahead_sector >= cache->ahead_end && !cache->quit)
+		{
+			pthread_cond_wait(&cache->work_cond, &cache->lock);
+		}
+		if (cache->quit) {
+			break;
+		}
+		uint32_t track = cache->ahead_track, sector = cache->ahead_sector++;
+		if (find_sector(cache, track, sector) >= 0) {
+			continue;
+		}
+		int entry = claim_sector(cache, track, sector);
+		pthread_mutex_unlock(&cache->lock);
+		load_sector(media, track, sector, cache->data[entry]);
+		pthread_mutex_lock(&cache->lock);
+		cache->state[entry] = SECTOR_READY;
+		pthread_cond_broadcast(&cache->done_cond);
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return NULL;
+}
+
+static void read_ahead(system_media *media, uint32_t track, uint32_t sector)
+{
+	cd_sector_cache *cache = get_sector_cache(media);
+	track_info *info = media->tracks + track;
+	if (info->mapped) {
+		//the OS takes care of read-ahead for mapped files
+		return;
+	}
+	uint32_t track_sectors = info->end_lba - info->pregap_lba - info->fake_pregap;
+	pthread_mutex_lock(&cache->lock);
+	if (!cache->has_thread) {
+		cache->has_thread = !pthread_create(&cache->thread, NULL, read_ahead_worker, media);
+	}
+	if (cache->has_thread) {
+		cache->ahead_track = track;
+		cache->ahead_sector = sector + 1;
+		cache->ahead_end = sector + 1 + SECTOR_READ_AHEAD;
+		if (cache->ahead_end > track_sectors) {
+			cache->ahead_end = track_sectors;
+		}
+		pthread_cond_signal(&cache->work_cond);
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+//tracks that share a file share its mapping, so each one is only released once
+static void unmap_tracks(system_media *media)
+{
+	for (uint32_t i = 0; i < media->num_tracks; i++)
+	{
+		track_info *info = media->tracks + i;
+		if (info->mapped && !(i && info->mapped == media->tracks[i - 1].mapped)) {
+			unmap_file(info->mapped, info->mapped_size);
+		}
+	}
+	for (uint32_t i = 0; i < media->num_tracks; i++)
+	{
+		media->tracks[i].mapped = NULL;
+		media->tracks[i].mapped_size = 0;
+	}
+}
+
+//media structs get reused when a new image is loaded, so anything cached for the old one has to go
+static void reset_sector_cache(system_media *media)
+{
+	media->read_pos = 0;
+	unmap_tracks(media);
+	cd_sector_cache *cache = media->sector_cache;
+	if (!cache) {
+		return;
+	}
+	pthread_mutex_lock(&cache->lock);
+	cache->ahead_end = cache->ahead_sector;
+	for (int i = 0; i < SECTOR_CACHE_ENTRIES; i++)
+	{
+		while (cache->state[i] == SECTOR_LOADING)
+		{
+			pthread_cond_wait(&cache->done_cond, &cache->lock);
+		}
+		cache->state[i] = SECTOR_EMPTY;
+	}
+	cache->cur_entry = SECTOR_CACHE_ENTRIES;
+	cache->cur_data = NULL;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void cdimage_free(system_media *media)
+{
+	reset_sector_cache(media);
+	cd_sector_cache *cache = media->sector_cache;
+	if (!cache) {
+		return;
+	}
+	if (cache->has_thread) {
+		pthread_mutex_lock(&cache->lock);
+		cache->quit = 1;
+		pthread_cond_signal(&cache->work_cond);
+		pthread_mutex_unlock(&cache->lock);
+		pthread_join(cache->thread, NULL);
+	}
+	pthread_mutex_destroy(&cache->lock);
+	pthread_mutex_destroy(&cache->io_lock);
+	pthread_cond_destroy(&cache->work_cond);
+	pthread_cond_destroy(&cache->done_cond);
+	free(cache);
+	media->sector_cache = NULL;
+}
+
+//Uncompressed tracks in regular files are memory mapped so reads don't need to go through stdio or the cache
+static void map_tracks(system_media *media)
+{
+	for (uint32_t i = 0; i < media->num_tracks; i++)
+	{
+		track_info *info = media->tracks + i;
+		if (!info->f || info->flac) {
+			continue;
+		}
+		if (i && info->f == media->tracks[i - 1].f) {
+			info->mapped = media->tracks[i - 1].mapped;
+			info->mapped_size = media->tracks[i - 1].mapped_size;
+		} else {
+			info->mapped = map_file(info->f, &info->mapped_size);
+		}
+	}
+}
+
+//makes the sector of the current track containing file position pos the one reads are served from
+static void select_sector(system_media *media, uint32_t pos)
+{
+	cd_sector_cache *cache = get_sector_cache(media);
+	track_info *info = media->tracks + media->cur_track;
+	uint32_t sector = (pos - info->file_offset) / info->sector_bytes;
+	cache->cur_track = media->cur_track;
+	cache->cur_start = info->file_offset + sector * info->sector_bytes;
+	cache->cur_end = cache->cur_start + info->sector_bytes;
+	if (info->mapped && cache->cur_end <= info->mapped_size) {
+		//sectors of mapped files are used in place
+		cache->cur_data = info->mapped + cache->cur_start;
+		return;
+	}
+	pthread_mutex_lock(&cache->lock);
+	int entry;
+	for (;;)
+	{
+		entry = find_sector(cache, media->cur_track, sector);
+		if (entry < 0 || cache->state[entry] == SECTOR_READY) {
+			break;
+		}
+		pthread_cond_wait(&cache->done_cond, &cache->lock);
+	}
+	if (entry < 0) {
+		entry = claim_sector(cache, media->cur_track, sector);
+		pthread_mutex_unlock(&cache->lock);
+		load_sector(media, media->cur_track, sector, cache->data[entry]);
+		pthread_mutex_lock(&cache->lock);
+		cache->state[entry] = SECTOR_READY;
+		pthread_cond_broadcast(&cache->done_cond);
+	}
+	cache->last_used[entry] = ++cache->use_counter;
+	cache->cur_entry = entry;
+	pthread_mutex_unlock(&cache->lock);
+	cache->cur_data = cache->data[entry];
+}
+
+static uint8_t peek_byte(system_media *media)
+{
+	cd_sector_cache *cache = get_sector_cache(media);
+	uint32_t pos = media->read_pos;
+	if (pos < media->tracks[media->cur_track].file_offset) {
+		return 0xFF;
+	}
+	if (!cache->cur_data || cache->cur_track != media->cur_track || pos < cache->cur_start || pos >= cache->cur_end) {
+		select_sector(media, pos);
+	}
+	return cache->cur_data[pos - cache->cur_start];
+}
+
+static uint8_t next_byte(system_media *media)
+{
+	uint8_t ret = peek_byte(media);
+	media->read_pos++;
+	return ret;
+}
+
 static uint8_t bin_seek(system_media *media, uint32_t sector)
 {
 	media->cur_sector = sector;
@@ -115,21 +425,16 @@ static uint8_t bin_seek(system_media *media, uint32_t sector)
 	if (track < media->num_tracks) {
 		media->cur_track = track;
 		if (!media->in_fake_pregap) {
-			if (media->tracks[track].flac) {
-				flac_seek(media->tracks[track].flac, (media->tracks[track].file_offset + rel * media->tracks[track].sector_bytes) / 4);
-			} else {
-				if (media->tracks[track].has_subcodes) {
-					if (!media->tmp_buffer) {
-						media->tmp_buffer = calloc(1, 96);
-					}
-					fseek(media->tracks[track].f, media->tracks[track].file_offset + (rel + 1) * media->tracks[track].sector_bytes - 96, SEEK_SET);
-					int bytes = fread(media->tmp_buffer, 1, 96, media->tracks[track].f);
-					if (bytes != 96) {
-						fprintf(stderr, "Only read %d subcode bytes\n", bytes);
-					}
+			media->read_pos = media->tracks[track].file_offset + rel * media->tracks[track].sector_bytes;
+			if (media->tracks[track].has_subcodes && !media->tracks[track].flac) {
+				if (!media->tmp_buffer) {
+					media->tmp_buffer = calloc(1, 96);
 				}
-				fseek(media->tracks[track].f, media->tracks[track].file_offset + rel * media->tracks[track].sector_bytes, SEEK_SET);
+				select_sector(media, media->read_pos);
+				cd_sector_cache *cache = media->sector_cache;
+				memcpy(media->tmp_buffer, cache->cur_data + media->tracks[track].sector_bytes - 96, 96);
 			}
+			read_ahead(media, track, rel);
 		}
 		if (media->tracks[track].type == TRACK_DATA) {
 			media->cdrom_scramble_lsfr = 1;
@@ -172,21 +477,22 @@ static uint8_t bin_read(system_media *media, uint32_t offset)
 		if (offset & 3) {
 			retval = media->byte_storage[(offset & 3) - 1];
 		} else {
-			int16_t samples[2];
-			flac_get_sample(media->tracks[media->cur_track].flac, samples, 2);
-			media->byte_storage[0] = samples[0] >> 8;
-			media->byte_storage[1] = samples[1];
-			media->byte_storage[2] = samples[1] >> 8;
-			retval = samples[0];
+			retval = next_byte(media);
+			media->byte_storage[0] = next_byte(media);
+			media->byte_storage[1] = next_byte(media);
+			media->byte_storage[2] = next_byte(media);
 		}
 	} else {
 		if (media->tracks[media->cur_track].need_swap) {
 			if (offset & 1) {
 				retval = media->byte_storage[0];
+				media->byte_storage[0] = next_byte(media);
+			} else {
+				media->byte_storage[0] = next_byte(media);
+				retval = peek_byte(media);
 			}
-			media->byte_storage[0] = fgetc(media->tracks[media->cur_track].f);
 		} else {
-			retval = fgetc(media->tracks[media->cur_track].f);
+			retval = next_byte(media);
 		}
 	}
 	if (offset >= 12 && media->tracks[media->cur_track].type == TRACK_DATA) {
@@ -226,6 +532,7 @@ static void print_toc(system_media *media)
 
 uint8_t parse_cue(system_media *media)
 {
+	reset_sector_cache(media);
 	char *line = media->buffer;
 	media->num_tracks = 0;
 	do {
@@ -462,12 +769,16 @@ uint8_t parse_cue(system_media *media)
 	}
 	print_toc(media);
 	uint8_t valid = media->num_tracks > 0 && media->tracks[0].f != NULL;
+	if (valid) {
+		map_tracks(media);
+	}
 	media->type = valid ? MEDIA_CDROM : MEDIA_CART;
 	return valid;
 }
 
 uint8_t parse_toc(system_media *media)
 {
+	reset_sector_cache(media);
 	char *line = media->buffer;
 	media->num_tracks = 0;
 	do {
@@ -645,6 +956,9 @@ uint8_t parse_toc(system_media *media)
 	}
 	print_toc(media);
 	uint8_t valid = media->num_tracks > 0 && media->tracks[0].f != NULL;
+	if (valid) {
+		map_tracks(media);
+	}
 	media->type = valid ? MEDIA_CDROM : MEDIA_CART;
 	return valid;
 }
@@ -655,6 +969,7 @@ uint32_t make_iso_media(system_media *media, const char *filename)
 	if (!f) {
 		return 0;
 	}
+	reset_sector_cache(media);
 	media->buffer = calloc(2048, 1);
 	media->size = fread(media->buffer, 1, 2048, f);
 	media->num_tracks = 1;
@@ -670,6 +985,7 @@ uint32_t make_iso_media(system_media *media, const char *filename)
 		.need_swap = 0,
 		.type = TRACK_DATA
 	};
+	map_tracks(media);
 	media->type = MEDIA_CDROM;
 	media->seek = bin_seek;
 	media->read = bin_read;
@@ -685,7 +1001,7 @@ void cdimage_serialize(system_media *media, serialize_buffer *buf)
 	save_int32(buf, media->cur_track);
 	save_int32(buf, media->cur_sector);
 	if (media->cur_track < media->num_tracks && media->tracks[media->cur_track].f) {
-		save_int32(buf, ftell(media->tracks[media->cur_track].f));
+		save_int32(buf, media->read_pos);
 	} else {
 		save_int32(buf, 0);
 	}
@@ -706,10 +1022,7 @@ void cdimage_deserialize(deserialize_buffer *buf, void *vmedia)
 	}
 	media->cur_track = load_int32(buf);
 	media->cur_sector = load_int32(buf);
-	uint32_t seekpos = load_int32(buf);
-	if (media->cur_track < media->num_tracks && media->tracks[media->cur_track].f) {
-		fseek(media->tracks[media->cur_track].f, seekpos, SEEK_SET);
-	}
+	media->read_pos = load_int32(buf);
 	media->in_fake_pregap = load_int8(buf);
 	media->byte_storage[0] = load_int8(buf);
 	if (media->tmp_buffer) {
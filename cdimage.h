@@ -4,6 +4,8 @@
 uint8_t parse_cue(system_media *media);
 uint8_t parse_toc(system_media *media);
 uint32_t make_iso_media(system_media *media, const char *filename);
+//Releases mappings, the sector cache and its read-ahead thread, the track files themselves stay open
+void cdimage_free(system_media *media);
 void cdimage_serialize(system_media *media, serialize_buffer *buf);
 void cdimage_deserialize(deserialize_buffer *buf, void *vmedia);
 uint8_t cdrom_scramble(uint16_t *lsfr, uint8_t data);
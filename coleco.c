@@ -121,9 +121,18 @@ void coleco_serialize(coleco_context *coleco, serialize_buffer *buf)
 	end_section(buf);
 }
 
+static void sync_to_instruction(coleco_context *coleco)
+{
+	while (!coleco->z80->pc) {
+		//advance Z80 to an instruction boundary
+		z80_run(coleco->z80, coleco->z80->Z80_CYCLE + 1);
+	}
+}
+
 static uint8_t *serialize(system_header *sys, size_t *size_out)
 {
 	coleco_context *coleco = (coleco_context *)sys;
+	sync_to_instruction(coleco);
 	serialize_buffer state;
 	init_serialize(&state);
 	coleco_serialize(coleco, &state);
@@ -133,6 +142,16 @@ static uint8_t *serialize(system_header *sys, size_t *size_out)
 	return state.data;
 }
 
+static size_t serialize_into(system_header *sys, uint8_t *dst, size_t size)
+{
+	coleco_context *coleco = (coleco_context *)sys;
+	sync_to_instruction(coleco);
+	serialize_buffer state;
+	init_serialize_fixed(&state, dst, size);
+	coleco_serialize(coleco, &state);
+	return state.size;
+}
+
 static void ram_deserialize(deserialize_buffer *buf, void *vcoleco)
 {
 	coleco_context *coleco = vcoleco;
@@ -248,11 +267,13 @@ static void run_coleco(system_header *system)
 				}
 			}
 
-			if(exit_after){
-				if (elapsed >= exit_after) {
-					exit(0);
+			if(system->exit_after){
+				if (elapsed >= system->exit_after) {
+					system->exit_after = 0;
+					system->should_exit = 1;
+					system_request_exit(system, 0);
 				} else {
-					exit_after -= elapsed;
+					system->exit_after -= elapsed;
 				}
 			}
 		}
@@ -274,10 +295,7 @@ static void run_coleco(system_header *system)
 		vdp_run_context(coleco->vdp, target_cycle);
 		psg_run(coleco->psg, target_cycle);
 		if (system->save_state) {
-			while (!coleco->z80->pc) {
-				//advance Z80 to an instruction boundary
-				z80_run(coleco->z80, coleco->z80->Z80_CYCLE + 1);
-			}
+			sync_to_instruction(coleco);
 			save_state(coleco, system->save_state - 1);
 			system->save_state = 0;
 		}
@@ -558,6 +576,7 @@ coleco_context *alloc_configure_coleco(system_media *media)
 	coleco->header.config_updated = config_updated;
 	coleco->header.serialize = serialize;
 	coleco->header.deserialize = deserialize;
+	coleco->header.serialize_into = serialize_into;
 	coleco->header.toggle_debug_view = toggle_debug_view;
 	coleco->header.type = SYSTEM_COLECOVISION;
 
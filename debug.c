@@ -1841,6 +1841,8 @@ static void debug_vram_set(debug_array *array, uint32_t index, debug_val val)
 		index = mode4_address_map[index & 0x3FFF] ^ 1;
 	}
 	vdp->vdpmem[index] = ival;
+	vdp_invalidate_tile_cache(vdp);
+	vdp_resync_pipeline(vdp);
 }
 
 static debug_val debug_vsram_get(debug_array *array, uint32_t index)
@@ -1858,6 +1860,7 @@ static void debug_vsram_set(debug_array *array, uint32_t index, debug_val val)
 	}
 	vdp_context *vdp = array->base;
 	vdp->vsram[index] = ival;
+	vdp_resync_pipeline(vdp);
 }
 
 static debug_val debug_cram_get(debug_array *array, uint32_t index)
@@ -1875,6 +1878,7 @@ static void debug_cram_set(debug_array *array, uint32_t index, debug_val val)
 	}
 	vdp_context *vdp = array->base;
 	vdp->cram[index] = ival;
+	vdp_resync_pipeline(vdp);
 }
 
 static debug_val debug_vreg_get(debug_array *array, uint32_t index)
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "libretro.h"
+#include "system.h"
+#include "util.h"
+
+//Runs ROMs headless for a fixed number of frames through the libretro interface and reports
+//emulation speed, per-component time and hashes of the final frame and the whole audio stream
+//Usage: framebench [-n FRAMES] ROM [ROM...]
+
+RETRO_API void blastem_set_profile(system_profile *new_profile);
+
+static const char *component_names[NUM_PROFILE_COMPONENTS] = {
+	[PROFILE_Z80] = "z80",
+	[PROFILE_VDP] = "vdp",
+	[PROFILE_YM] = "ym",
+	[PROFILE_PSG] = "psg",
+	[PROFILE_CD] = "cd"
+};
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static const uint8_t *last_frame;
+static unsigned last_width, last_height;
+static size_t last_pitch;
+static unsigned bytes_per_pixel = 2;
+static uint64_t audio_hash;
+static uint64_t audio_frames;
+
+static bool environment(unsigned cmd, void *data)
+{
+	if (cmd == RETRO_ENVIRONMENT_SET_PIXEL_FORMAT) {
+		switch (*(const enum retro_pixel_format *)data)
+		{
+		case RETRO_PIXEL_FORMAT_XRGB8888:
+			bytes_per_pixel = 4;
+			return 1;
+		case RETRO_PIXEL_FORMAT_RGB565:
+		case RETRO_PIXEL_FORMAT_0RGB1555:
+			bytes_per_pixel = 2;
+			return 1;
+		default:
+			return 0;
+		}
+	}
+	return 0;
+}
+
+static void video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+	if (data) {
+		last_frame = data;
+		last_width = width;
+		last_height = height;
+		last_pitch = pitch;
+	}
+}
+
+static void audio_sample(int16_t left, int16_t right)
+{
+	int16_t frame[2] = {left, right};
+	audio_hash = fnv1a(audio_hash, (uint8_t *)frame, sizeof(frame));
+	audio_frames++;
+}
+
+static size_t audio_sample_batch(const int16_t *data, size_t frames)
+{
+	audio_hash = fnv1a(audio_hash, (const uint8_t *)data, frames * 2 * sizeof(*data));
+	audio_frames += frames;
+	return frames;
+}
+
+static void input_poll(void)
+{
+}
+
+static int16_t input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	return 0;
+}
+
+static uint64_t frame_hash(void)
+{
+	uint64_t hash = FNV_OFFSET;
+	if (!last_frame) {
+		return hash;
+	}
+	//only the visible part of each line is hashed, the pitch covers unrelated buffer contents
+	for (unsigned y = 0; y < last_height; y++)
+	{
+		hash = fnv1a(hash, last_frame + y * last_pitch, last_width * bytes_per_pixel);
+	}
+	return hash;
+}
+
+static int bench_rom(char *path, uint32_t frames)
+{
+	struct retro_game_info info = {
+		.path = path
+	};
+	system_profile profile = {0};
+	last_frame = NULL;
+	//libretro's default format until the core asks for another
+	bytes_per_pixel = 2;
+	audio_hash = FNV_OFFSET;
+	audio_frames = 0;
+	if (!retro_load_game(&info)) {
+		fprintf(stderr, "Failed to load %s\n", path);
+		return 0;
+	}
+	blastem_set_profile(&profile);
+	uint64_t start = get_monotonic_ns();
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		retro_run();
+	}
+	uint64_t total = get_monotonic_ns() - start;
+	//the main CPU isn't timed directly, it gets whatever isn't attributed to a component,
+	//which includes the glue between components and the frontend callbacks
+	uint64_t main_cpu = total;
+	for (int i = 0; i < NUM_PROFILE_COMPONENTS; i++)
+	{
+		main_cpu = profile.ns[i] < main_cpu ? main_cpu - profile.ns[i] : 0;
+	}
+	double seconds = total / 1000000000.0;
+	printf("%s: %u frames in %.3f s, %.2f fps\n", path, frames, seconds, seconds > 0 ? frames / seconds : 0.0);
+	printf("\tmain (remainder) %.3f ms (%.1f%%)", main_cpu / 1000000.0, total ? main_cpu * 100.0 / total : 0.0);
+	for (int i = 0; i < NUM_PROFILE_COMPONENTS; i++)
+	{
+		printf(", %s %.3f ms (%.1f%%)", component_names[i], profile.ns[i] / 1000000.0, total ? profile.ns[i] * 100.0 / total : 0.0);
+	}
+	printf("\n\tframe %016llX (%ux%u), audio %016llX (%llu frames)\n",
+		(unsigned long long)frame_hash(), last_width, last_height,
+		(unsigned long long)audio_hash, (unsigned long long)audio_frames
+	);
+	retro_unload_game();
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = 600;
+	int i;
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Option %s requires an argument\n", argv[i]);
+			return 1;
+		}
+		switch (argv[i][1])
+		{
+		case 'n':
+			frames = atoi(argv[++i]);
+			break;
+		default:
+			fprintf(stderr, "Unrecognized option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (i >= argc || !frames) {
+		fputs("Usage: framebench [-n FRAMES] ROM [ROM...]\n", stderr);
+		return 1;
+	}
+	retro_set_environment(environment);
+	retro_set_video_refresh(video_refresh);
+	retro_set_audio_sample(audio_sample);
+	retro_set_audio_sample_batch(audio_sample_batch);
+	retro_set_input_poll(input_poll);
+	retro_set_input_state(input_state);
+	retro_init();
+	int ret = 0;
+	for (; i < argc; i++)
+	{
+		if (!bench_rom(argv[i], frames)) {
+			ret = 1;
+		}
+	}
+	retro_deinit();
+	return ret;
+}
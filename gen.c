@@ -13,4 +13,56 @@ void init_code_info(code_info *code)
 	}
 	code->last = code->cur + size/sizeof(code_word) - RESERVE_WORDS;
 	code->stack_off = 0;
+	code->pool = NULL;
+}
+
+struct code_pool {
+	code_ptr *chunks;
+	uint32_t num_chunks;
+	uint32_t storage;
+	uint32_t next;
+};
+
+void *alloc_code_chunk(code_info *code, size_t *size)
+{
+	code_pool *pool = code->pool;
+	if (pool && pool->next < pool->num_chunks) {
+		//chunks are always allocated with the same size so a rewound one can be handed out as-is
+		*size = CODE_ALLOC_SIZE;
+		return pool->chunks[pool->next++];
+	}
+	code_ptr chunk = alloc_code(size);
+	if (chunk && pool) {
+		if (pool->num_chunks == pool->storage) {
+			pool->storage = pool->storage ? pool->storage * 2 : 4;
+			pool->chunks = realloc(pool->chunks, pool->storage * sizeof(code_ptr));
+		}
+		pool->chunks[pool->num_chunks++] = chunk;
+		pool->next = pool->num_chunks;
+	}
+	return chunk;
+}
+
+void start_code_pool(code_info *code)
+{
+	code->pool = calloc(1, sizeof(code_pool));
+}
+
+uint32_t code_pool_mark(code_info *code)
+{
+	return code->pool->next;
+}
+
+void code_pool_rewind(code_info *code, uint32_t mark)
+{
+	code->pool->next = mark;
+}
+
+void free_code_pool(code_info *code)
+{
+	if (code->pool) {
+		free(code->pool->chunks);
+		free(code->pool);
+		code->pool = NULL;
+	}
 }
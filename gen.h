@@ -1,6 +1,7 @@
 #ifndef GEN_H_
 #define GEN_H_
 #include <stdint.h>
+#include <stddef.h>
 
 #if defined(X86_64) || defined(X86_32)
 typedef uint8_t code_word;
@@ -12,15 +13,23 @@ typedef uint32_t code_word;
 typedef code_word * code_ptr;
 #define CODE_ALLOC_SIZE (1024*1024)
 
+typedef struct code_pool code_pool;
+
 typedef struct {
-	code_ptr cur;
-	code_ptr last;
-	uint32_t stack_off;
+	code_ptr  cur;
+	code_ptr  last;
+	uint32_t  stack_off;
+	code_pool *pool; //chunks allocated for this stream so far, NULL when they are never reclaimed
 } code_info;
 
 void check_alloc_code(code_info *code, uint32_t inst_size);
 
 void init_code_info(code_info *code);
+void *alloc_code_chunk(code_info *code, size_t *size);
+void start_code_pool(code_info *code);
+uint32_t code_pool_mark(code_info *code);
+void code_pool_rewind(code_info *code, uint32_t mark);
+void free_code_pool(code_info *code);
 void call(code_info *code, code_ptr fun);
 void jmp(code_info *code, code_ptr dest);
 void jmp_r(code_info *code, uint8_t dst);
@@ -205,7 +205,7 @@ void check_alloc_code(code_info *code, uint32_t inst_size)
 {
 	if (code->cur + inst_size > code->last) {
 		size_t size = CODE_ALLOC_SIZE;
-		code_ptr next_code = alloc_code(&size);
+		code_ptr next_code = alloc_code_chunk(code, &size);
 		if (!next_code) {
 			fatal_error("Failed to allocate memory for generated code\n");
 		}
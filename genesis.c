@@ -22,10 +22,10 @@
 #include "config.h"
 #include "event_log.h"
 #include "paths.h"
+#include "version.inc"
 #define MCLKS_NTSC 53693175
 #define MCLKS_PAL  53203395
 
-uint32_t MCLKS_PER_68K;
 #define MCLKS_PER_YM  7
 #define MCLKS_PER_Z80 15
 #define MCLKS_PER_PSG (MCLKS_PER_Z80*16)
@@ -134,10 +134,37 @@ void genesis_serialize(genesis_context *gen, serialize_buffer *buf, uint32_t m68
 	}
 }
 
+static serialize_buffer *slot_state_buffer(genesis_context *gen, uint8_t slot, serialize_buffer *tmp)
+{
+	if (slot == SERIALIZE_SLOT && gen->serialize_dst) {
+		return gen->serialize_dst;
+	}
+	if (slot == REWIND_SLOT || slot == RUNAHEAD_SLOT) {
+		serialize_buffer *buf = slot == REWIND_SLOT ? &gen->rewind_state : &gen->runahead_state;
+		if (buf->data) {
+			reset_serialize(buf);
+		} else {
+			init_serialize(buf);
+		}
+		return buf;
+	}
+	init_serialize(tmp);
+	return tmp;
+}
+
 static uint8_t *serialize(system_header *sys, size_t *size_out)
 {
 	genesis_context *gen = (genesis_context *)sys;
 	uint32_t address;
+	if (system_runahead_speculating(sys) && gen->runahead_state.size) {
+		//emulated state is ahead of what the frontend has presented, hand out the real one
+		uint8_t *ret = malloc(gen->runahead_state.size);
+		memcpy(ret, gen->runahead_state.data, gen->runahead_state.size);
+		if (size_out) {
+			*size_out = gen->runahead_state.size;
+		}
+		return ret;
+	}
 #ifndef NEW_CORE
 	if (gen->m68k->resume_pc) {
 		
@@ -168,6 +195,35 @@ static uint8_t *serialize(system_header *sys, size_t *size_out)
 	}
 }
 
+static size_t serialize_into(system_header *sys, uint8_t *dst, size_t size)
+{
+	genesis_context *gen = (genesis_context *)sys;
+	if (system_runahead_speculating(sys) && gen->runahead_state.size) {
+		if (gen->runahead_state.size <= size) {
+			memcpy(dst, gen->runahead_state.data, gen->runahead_state.size);
+		}
+		return gen->runahead_state.size;
+	}
+	serialize_buffer state;
+	init_serialize_fixed(&state, dst, size);
+#ifndef NEW_CORE
+	if (gen->m68k->resume_pc) {
+		gen->serialize_dst = &state;
+		gen->header.save_state = SERIALIZE_SLOT+1;
+		while (gen->serialize_dst)
+		{
+			gen->m68k->target_cycle = gen->m68k->cycles + 1;
+			resume_68k(gen->m68k);
+		}
+		return state.size;
+	}
+#endif
+	uint32_t address = read_word(4, (void **)gen->m68k->mem_pointers, &gen->m68k->opts->gen, gen->m68k) << 16;
+	address |= read_word(6, (void **)gen->m68k->mem_pointers, &gen->m68k->opts->gen, gen->m68k);
+	genesis_serialize(gen, &state, address, 1);
+	return state.size;
+}
+
 static void ram_deserialize(deserialize_buffer *buf, void *vgen)
 {
 	genesis_context *gen = vgen;
@@ -300,14 +356,16 @@ void genesis_deserialize(deserialize_buffer *buf, genesis_context *gen)
 static void deserialize(system_header *sys, uint8_t *data, size_t size)
 {
 	genesis_context *gen = (genesis_context *)sys;
+	system_runahead_cancel(sys);
+	vdp_set_output_suppressed(gen->vdp, 0);
 	deserialize_buffer buffer;
 	init_deserialize(&buffer, data, size);
 	genesis_deserialize(&buffer, gen);
 }
 
-uint16_t read_dma_value(uint32_t address)
+uint16_t read_dma_value(system_header *system, uint32_t address)
 {
-	genesis_context *genesis = (genesis_context *)current_system;
+	genesis_context *genesis = (genesis_context *)system;
 	address *= 2;
 	//TODO: Figure out what happens when you try to DMA from weird adresses like IO or banked Z80 area
 	if ((address >= 0xA00000 && address < 0xB00000) || (address >= 0xC00000 && address <= 0xE00000)) {
@@ -335,9 +393,9 @@ uint16_t read_dma_value(uint32_t address)
 	return read_word(address, (void **)genesis->m68k->mem_pointers, &genesis->m68k->opts->gen, genesis->m68k);
 }
 
-void vdp_dma_started(void)
+void vdp_dma_started(system_header *system)
 {
-	genesis_context *genesis = (genesis_context *)current_system;
+	genesis_context *genesis = (genesis_context *)system;
 	if (genesis->expansion) {
 		segacd_context *cd = genesis->expansion;
 		cd->has_vdp_dma_value = 0;
@@ -351,7 +409,7 @@ static uint16_t get_open_bus_value(system_header *system)
 #ifdef NEW_CORE
 	return genesis->m68k->prefetch;
 #else
-	return read_dma_value(genesis->m68k->last_prefetch_address/2);
+	return read_dma_value(system, genesis->m68k->last_prefetch_address/2);
 #endif
 }
 
@@ -464,7 +522,7 @@ static void sync_z80(genesis_context *gen, uint32_t mclks)
 {
 	z80_context *z_context = gen->z80;
 #ifndef NO_Z80
-	if (z80_enabled) {
+	if (gen->z80_enabled) {
 #ifdef NEW_CORE
 		if (z_context->int_cycle == 0xFFFFFFFFU) {
 			z80_next_int_pulse(z_context);
@@ -487,23 +545,48 @@ static void sync_z80(genesis_context *gen, uint32_t mclks)
 	}
 }
 
+static void flush_deferred_sound(genesis_context *gen)
+{
+	if (gen->psg->synth && gen->ym->synth) {
+		//render in slices shorter than an audio sync so neither chip gets a buffer ahead
+		//of the other, otherwise the frontend can drop buffers waiting for the mixer
+		uint32_t slice = render_audio_sync_cycles(gen->master_clock) / 2;
+		if (slice < MCLKS_PER_PSG) {
+			slice = MCLKS_PER_PSG;
+		}
+		uint32_t target = gen->psg->cycles;
+		uint32_t cur = gen->psg->synth->cycles;
+		while (target > cur && target - cur > slice) {
+			cur += slice;
+			PROFILE_RUN(&gen->header, PROFILE_PSG, psg_render_deferred(gen->psg, cur));
+			PROFILE_RUN(&gen->header, PROFILE_YM, ym_render_deferred(gen->ym, cur));
+		}
+	}
+	PROFILE_RUN(&gen->header, PROFILE_PSG, psg_flush_deferred(gen->psg));
+	PROFILE_RUN(&gen->header, PROFILE_YM, ym_flush_deferred(gen->ym));
+}
+
 static void sync_sound(genesis_context * gen, uint32_t target)
 {
 	//printf("YM | Cycle: %d, bpos: %d, PSG | Cycle: %d, bpos: %d\n", gen->ym->current_cycle, gen->ym->buffer_pos, gen->psg->cycles, gen->psg->buffer_pos * 2);
 	while (target > gen->psg->cycles && target - gen->psg->cycles > MAX_SOUND_CYCLES) {
 		uint32_t cur_target = gen->psg->cycles + MAX_SOUND_CYCLES;
 		//printf("Running PSG to cycle %d\n", cur_target);
-		psg_run(gen->psg, cur_target);
+		PROFILE_RUN(&gen->header, PROFILE_PSG, psg_run(gen->psg, cur_target));
 		//printf("Running YM-2612 to cycle %d\n", cur_target);
-		ym_run(gen->ym, cur_target);
+		PROFILE_RUN(&gen->header, PROFILE_YM, ym_run(gen->ym, cur_target));
 		if (gen->expansion) {
-			scd_run(gen->expansion, gen_cycle_to_scd(cur_target, gen));
+			PROFILE_RUN(&gen->header, PROFILE_CD, scd_run(gen->expansion, gen_cycle_to_scd(cur_target, gen)));
 		}
 	}
-	psg_run(gen->psg, target);
-	ym_run(gen->ym, target);
+	PROFILE_RUN(&gen->header, PROFILE_PSG, psg_run(gen->psg, target));
+	PROFILE_RUN(&gen->header, PROFILE_YM, ym_run(gen->ym, target));
 	if (gen->expansion) {
-		scd_run(gen->expansion, gen_cycle_to_scd(target, gen));
+		PROFILE_RUN(&gen->header, PROFILE_CD, scd_run(gen->expansion, gen_cycle_to_scd(target, gen)));
+	}
+	if (ym_deferred_full(gen->ym) || psg_deferred_full(gen->psg)) {
+		//both chips are synced to target here, so this is the place to drain a full write queue
+		flush_deferred_sound(gen);
 	}
 
 	//printf("Target: %d, YM bufferpos: %d, PSG bufferpos: %d\n", target, gen->ym->buffer_pos, gen->psg->buffer_pos * 2);
@@ -514,42 +597,42 @@ static void sync_sound(genesis_context * gen, uint32_t target)
 
 void gen_update_refresh(m68k_context *context)
 {
-	uint32_t interval = MCLKS_PER_68K * REFRESH_INTERVAL;
 	genesis_context *gen = context->system;
+	uint32_t interval = gen->mclks_per_68k * REFRESH_INTERVAL;
 	gen->refresh_counter += context->cycles - gen->last_sync_cycle;
 	gen->last_sync_cycle = context->cycles;
-	context->cycles += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / interval);
+	context->cycles += REFRESH_DELAY * gen->mclks_per_68k * (gen->refresh_counter / interval);
 	gen->refresh_counter = gen->refresh_counter % interval;
 }
 
 void gen_update_refresh_free_access(m68k_context *context)
 {
 	genesis_context *gen = context->system;
-	uint32_t before = context->cycles - 4*MCLKS_PER_68K;
+	uint32_t before = context->cycles - 4*gen->mclks_per_68k;
 	if (before < gen->last_sync_cycle) {
 		return;
 	}
 	//Add refresh delays for any accesses that happened beofre the current one
 	gen->refresh_counter += before - gen->last_sync_cycle;
-	uint32_t interval = MCLKS_PER_68K * REFRESH_INTERVAL;
-	uint32_t delay = REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / interval);
+	uint32_t interval = gen->mclks_per_68k * REFRESH_INTERVAL;
+	uint32_t delay = REFRESH_DELAY * gen->mclks_per_68k * (gen->refresh_counter / interval);
 	if (delay) {
 		//To avoid the extra cycles being absorbed in the refresh free update below, we need to update again
 		gen->refresh_counter = gen->refresh_counter % interval;
 		gen->refresh_counter += delay;
-		delay += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / interval);
+		delay += REFRESH_DELAY * gen->mclks_per_68k * (gen->refresh_counter / interval);
 		context->cycles += delay;
 	}
 	gen->last_sync_cycle = context->cycles;
 	//advance refresh counter for the current access, but don't generate delays
-	gen->refresh_counter += 4*MCLKS_PER_68K;
+	gen->refresh_counter += 4*gen->mclks_per_68k;
 	gen->refresh_counter = gen->refresh_counter % interval;
 }
 
 void gen_update_refresh_no_wait(m68k_context *context)
 {
-	uint32_t interval = MCLKS_PER_68K * REFRESH_INTERVAL;
 	genesis_context *gen = context->system;
+	uint32_t interval = gen->mclks_per_68k * REFRESH_INTERVAL;
 	gen->refresh_counter += context->cycles - gen->last_sync_cycle;
 	gen->last_sync_cycle = context->cycles;
 	gen->refresh_counter = gen->refresh_counter % interval;
@@ -571,14 +654,14 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 	}
 
 	uint32_t mclks = context->cycles;
-	sync_z80(gen, mclks);
+	PROFILE_RUN(&gen->header, PROFILE_Z80, sync_z80(gen, mclks));
 	sync_sound(gen, mclks);
-	vdp_run_context(v_context, mclks);
+	PROFILE_RUN(&gen->header, PROFILE_VDP, vdp_run_context(v_context, mclks));
 	io_run(gen->io.ports, mclks);
 	io_run(gen->io.ports + 1, mclks);
 	io_run(gen->io.ports + 2, mclks);
 	if (gen->expansion) {
-		scd_run(gen->expansion, gen_cycle_to_scd(mclks, gen));
+		PROFILE_RUN(&gen->header, PROFILE_CD, scd_run(gen->expansion, gen_cycle_to_scd(mclks, gen)));
 	}
 	if (mclks >= gen->reset_cycle) {
 		gen->reset_requested = 1;
@@ -586,6 +669,7 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 		gen->reset_cycle = CYCLE_NEVER;
 	}
 	if (v_context->frame != gen->last_frame) {
+		flush_deferred_sound(gen);
 #ifndef IS_LIB
 		if (gen->ym->scope) {
 			scope_render(gen->ym->scope);
@@ -605,13 +689,24 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 			}
 		}
 
-		if(exit_after){
-			if (elapsed >= exit_after) {
-				exit(0);
+		if(gen->header.exit_after){
+			if (elapsed >= gen->header.exit_after) {
+				gen->header.exit_after = 0;
+				gen->header.should_exit = 1;
+				system_request_exit(&gen->header, 0);
 			} else {
-				exit_after -= elapsed;
+				gen->header.exit_after -= elapsed;
 			}
 		}
+		if (system_rewind_frame(&gen->header)) {
+			gen->header.delayed_load_slot = REWIND_SLOT + 1;
+			context->should_return = 1;
+		} else if (system_runahead_frame(&gen->header)) {
+			gen->header.delayed_load_slot = RUNAHEAD_SLOT + 1;
+			context->should_return = 1;
+		}
+		vdp_set_output_suppressed(v_context, gen->header.suppress_video);
+		m68k_aot_install(context);
 		if (context->cycles > MAX_NO_ADJUST) {
 			uint32_t deduction = mclks - ADJUST_BUFFER;
 			vdp_adjust_cycles(v_context, deduction);
@@ -627,7 +722,7 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 			if (gen->ym->vgm) {
 				vgm_adjust_cycles(gen->ym->vgm, deduction);
 			}
-			gen->psg->cycles -= deduction;
+			psg_adjust_cycles(gen->psg, deduction);
 			if (gen->reset_cycle != CYCLE_NEVER) {
 				gen->reset_cycle -= deduction;
 			}
@@ -645,7 +740,8 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 	gen->frame_end = vdp_cycles_to_frame_end(v_context);
 	context->sync_cycle = gen->frame_end;
 	//printf("Set sync cycle to: %d @ %d, vcounter: %d, hslot: %d\n", context->sync_cycle, context->cycles, v_context->vcounter, v_context->hslot);
-	if (!address && (gen->header.enter_debugger || gen->header.save_state)) {
+	//a stopped 68K won't reach an instruction boundary before the next interrupt, syncing every cycle until then just burns time
+	if (!address && !context->stopped && (gen->header.enter_debugger || gen->header.save_state)) {
 		context->sync_cycle = context->cycles + 1;
 	}
 	adjust_int_cycle(context, v_context);
@@ -684,15 +780,24 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 			char *save_path = slot >= SERIALIZE_SLOT ? NULL : get_slot_name(&gen->header, slot, use_native_states ? "state" : "gst");
 			if (use_native_states || slot >= SERIALIZE_SLOT) {
 				serialize_buffer state;
-				init_serialize(&state);
-				genesis_serialize(gen, &state, address, slot != EVENTLOG_SLOT);
+				serialize_buffer *out = slot_state_buffer(gen, slot, &state);
+				genesis_serialize(gen, out, address, slot != EVENTLOG_SLOT);
 				if (slot == SERIALIZE_SLOT) {
-					gen->serialize_tmp = state.data;
-					gen->serialize_size = state.size;
+					if (out == gen->serialize_dst) {
+						gen->serialize_dst = NULL;
+					} else {
+						gen->serialize_tmp = state.data;
+						gen->serialize_size = state.size;
+					}
 					context->sync_cycle = context->cycles;
 					context->should_return = 1;
 				} else if (slot == EVENTLOG_SLOT) {
 					event_state(context->cycles, &state);
+				} else if (slot == REWIND_SLOT) {
+					rewind_push(gen->header.rewind, out->data, out->size);
+				} else if (slot == RUNAHEAD_SLOT) {
+					vdp_mark_output_position(v_context);
+					system_runahead_saved(&gen->header, out->data, out->size);
 				} else {
 					save_to_file(&state, save_path);
 					free(state.data);
@@ -700,7 +805,7 @@ static m68k_context *sync_components(m68k_context * context, uint32_t address)
 			} else {
 				save_gst(gen, save_path, address);
 			}
-			if (slot != SERIALIZE_SLOT) {
+			if (slot != SERIALIZE_SLOT && slot != REWIND_SLOT && slot != RUNAHEAD_SLOT) {
 				debug_message("Saved state to %s\n", save_path);
 			}
 			free(save_path);
@@ -721,7 +826,7 @@ static void sync_sound_pico(genesis_context * gen, uint32_t target)
 	while (target > gen->psg->cycles && target - gen->psg->cycles > MAX_SOUND_CYCLES)
 	{
 		uint32_t cur_target = gen->psg->cycles + MAX_SOUND_CYCLES;
-		psg_run(gen->psg, cur_target);
+		PROFILE_RUN(&gen->header, PROFILE_PSG, psg_run(gen->psg, cur_target));
 		pico_pcm_run(gen->adpcm, cur_target);
 		if (gen->ymz) {
 			//FIXME: These have a separate crystal
@@ -729,7 +834,7 @@ static void sync_sound_pico(genesis_context * gen, uint32_t target)
 			ymf262_run(gen->opl, cur_target);
 		}
 	}
-	psg_run(gen->psg, target);
+	PROFILE_RUN(&gen->header, PROFILE_PSG, psg_run(gen->psg, target));
 	pico_pcm_run(gen->adpcm, target);
 	if (gen->ymz) {
 		ymz263b_run(gen->ymz, target);
@@ -848,7 +953,7 @@ static m68k_context* sync_components_pico(m68k_context * context, uint32_t addre
 
 	uint32_t mclks = context->cycles;
 	sync_sound_pico(gen, mclks);
-	vdp_run_context(v_context, mclks);
+	PROFILE_RUN(&gen->header, PROFILE_VDP, vdp_run_context(v_context, mclks));
 	if (mclks >= gen->reset_cycle) {
 		gen->reset_requested = 1;
 		context->should_return = 1;
@@ -874,13 +979,24 @@ static m68k_context* sync_components_pico(m68k_context * context, uint32_t addre
 			}
 		}
 
-		if(exit_after){
-			if (elapsed >= exit_after) {
-				exit(0);
+		if(gen->header.exit_after){
+			if (elapsed >= gen->header.exit_after) {
+				gen->header.exit_after = 0;
+				gen->header.should_exit = 1;
+				system_request_exit(&gen->header, 0);
 			} else {
-				exit_after -= elapsed;
+				gen->header.exit_after -= elapsed;
 			}
 		}
+		if (system_rewind_frame(&gen->header)) {
+			gen->header.delayed_load_slot = REWIND_SLOT + 1;
+			context->should_return = 1;
+		} else if (system_runahead_frame(&gen->header)) {
+			gen->header.delayed_load_slot = RUNAHEAD_SLOT + 1;
+			context->should_return = 1;
+		}
+		vdp_set_output_suppressed(v_context, gen->header.suppress_video);
+		m68k_aot_install(context);
 		if (context->cycles > MAX_NO_ADJUST) {
 			uint32_t deduction = mclks - ADJUST_BUFFER;
 			vdp_adjust_cycles(v_context, deduction);
@@ -891,7 +1007,7 @@ static m68k_context* sync_components_pico(m68k_context * context, uint32_t addre
 			if (gen->psg->vgm) {
 				vgm_adjust_cycles(gen->psg->vgm, deduction);
 			}
-			gen->psg->cycles -= deduction;
+			psg_adjust_cycles(gen->psg, deduction);
 			gen->adpcm->cycle -= deduction;
 			if (gen->ymz) {
 				gen->ymz->cycle -= deduction;
@@ -913,7 +1029,8 @@ static m68k_context* sync_components_pico(m68k_context * context, uint32_t addre
 	gen->frame_end = vdp_cycles_to_frame_end(v_context);
 	context->sync_cycle = gen->frame_end;
 	//printf("Set sync cycle to: %d @ %d, vcounter: %d, hslot: %d\n", context->sync_cycle, context->cycles, v_context->vcounter, v_context->hslot);
-	if (!address && (gen->header.enter_debugger || gen->header.save_state)) {
+	//a stopped 68K won't reach an instruction boundary before the next interrupt, syncing every cycle until then just burns time
+	if (!address && !context->stopped && (gen->header.enter_debugger || gen->header.save_state)) {
 		context->sync_cycle = context->cycles + 1;
 	}
 	adjust_int_cycle_pico(context, v_context);
@@ -939,15 +1056,24 @@ static m68k_context* sync_components_pico(m68k_context * context, uint32_t addre
 			char *save_path = slot >= SERIALIZE_SLOT ? NULL : get_slot_name(&gen->header, slot, use_native_states ? "state" : "gst");
 			if (use_native_states || slot >= SERIALIZE_SLOT) {
 				serialize_buffer state;
-				init_serialize(&state);
-				genesis_serialize(gen, &state, address, slot != EVENTLOG_SLOT);
+				serialize_buffer *out = slot_state_buffer(gen, slot, &state);
+				genesis_serialize(gen, out, address, slot != EVENTLOG_SLOT);
 				if (slot == SERIALIZE_SLOT) {
-					gen->serialize_tmp = state.data;
-					gen->serialize_size = state.size;
+					if (out == gen->serialize_dst) {
+						gen->serialize_dst = NULL;
+					} else {
+						gen->serialize_tmp = state.data;
+						gen->serialize_size = state.size;
+					}
 					context->sync_cycle = context->cycles;
 					context->should_return = 1;
 				} else if (slot == EVENTLOG_SLOT) {
 					event_state(context->cycles, &state);
+				} else if (slot == REWIND_SLOT) {
+					rewind_push(gen->header.rewind, out->data, out->size);
+				} else if (slot == RUNAHEAD_SLOT) {
+					vdp_mark_output_position(v_context);
+					system_runahead_saved(&gen->header, out->data, out->size);
 				} else {
 					save_to_file(&state, save_path);
 					free(state.data);
@@ -955,7 +1081,7 @@ static m68k_context* sync_components_pico(m68k_context * context, uint32_t addre
 			} else {
 				save_gst(gen, save_path, address);
 			}
-			if (slot != SERIALIZE_SLOT) {
+			if (slot != SERIALIZE_SLOT && slot != REWIND_SLOT && slot != RUNAHEAD_SLOT) {
 				debug_message("Saved state to %s\n", save_path);
 			}
 			free(save_path);
@@ -1026,9 +1152,9 @@ static m68k_context * vdp_port_write(uint32_t vdp_port, m68k_context * context,
 						vdp_run_dma_done(v_context, gen->frame_end);
 						if (v_context->cycles >= gen->frame_end) {
 							uint32_t cycle_diff = v_context->cycles - context->cycles;
-							uint32_t m68k_cycle_diff = (cycle_diff / MCLKS_PER_68K) * MCLKS_PER_68K;
+							uint32_t m68k_cycle_diff = (cycle_diff / gen->mclks_per_68k) * gen->mclks_per_68k;
 							if (m68k_cycle_diff < cycle_diff) {
-								m68k_cycle_diff += MCLKS_PER_68K;
+								m68k_cycle_diff += gen->mclks_per_68k;
 							}
 							context->cycles += m68k_cycle_diff;
 							gen->bus_busy = 1;
@@ -1062,9 +1188,9 @@ static m68k_context * vdp_port_write(uint32_t vdp_port, m68k_context * context,
 		if (v_context->cycles != before_cycle) {
 			//printf("68K paused for %d (%d) cycles at cycle %d (%d) for write\n", v_context->cycles - context->cycles, v_context->cycles - before_cycle, context->cycles, before_cycle);
 			uint32_t cycle_diff = v_context->cycles - context->cycles;
-			uint32_t m68k_cycle_diff = (cycle_diff / MCLKS_PER_68K) * MCLKS_PER_68K;
+			uint32_t m68k_cycle_diff = (cycle_diff / gen->mclks_per_68k) * gen->mclks_per_68k;
 			if (m68k_cycle_diff < cycle_diff) {
-				m68k_cycle_diff += MCLKS_PER_68K;
+				m68k_cycle_diff += gen->mclks_per_68k;
 			}
 			context->cycles += m68k_cycle_diff;
 			if (gen->header.type == SYSTEM_GENESIS) {
@@ -1159,7 +1285,7 @@ static uint16_t vdp_port_read(uint32_t vdp_port, m68k_context * context)
 	uint32_t before_cycle = context->cycles;
 	if (vdp_port < 0x10) {
 		if (vdp_port < 4) {
-			value = vdp_data_port_read(v_context, &context->cycles, MCLKS_PER_68K);
+			value = vdp_data_port_read(v_context, &context->cycles, gen->mclks_per_68k);
 		} else if(vdp_port < 8) {
 			value = vdp_control_port_read(v_context);
 		} else {
@@ -1211,7 +1337,7 @@ static uint8_t z80_vdp_port_read(uint32_t vdp_port, void * vcontext)
 	//TODO: add cycle for an access right after a previous one
 	//TODO: Below cycle time is an estimate based on the time between 68K !BG goes low and Z80 !MREQ goes high
 	//      Needs a new logic analyzer capture to get the actual delay on the 68K side
-	gen->m68k->cycles += 8 * MCLKS_PER_68K;
+	gen->m68k->cycles += 8 * gen->mclks_per_68k;
 
 
 	vdp_port &= 0x1F;
@@ -1237,9 +1363,6 @@ static uint8_t z80_vdp_port_read(uint32_t vdp_port, void * vcontext)
 	return vdp_port & 1 ? ret : ret >> 8;
 }
 
-//TODO: Move this inside the system context
-static uint32_t zram_counter = 0;
-
 static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_t value)
 {
 	genesis_context * gen = context->system;
@@ -1249,8 +1372,8 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 
 	if (location < 0x10000) {
 		//Access to Z80 memory incurs a one 68K cycle wait state
-		context->cycles += MCLKS_PER_68K;
-		if (!z80_enabled || z80_get_busack(gen->z80, context->cycles)) {
+		context->cycles += gen->mclks_per_68k;
+		if (!gen->z80_enabled || z80_get_busack(gen->z80, context->cycles)) {
 			location &= 0x7FFF;
 			if (location < 0x4000) {
 				gen->zram[location & 0x1FFF] = value;
@@ -1329,7 +1452,7 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 			if (masked == 0x11100) {
 				if (value & 1) {
 					dputs("bus requesting Z80");
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_assert_busreq(gen->z80, context->cycles);
 					} else {
 						gen->z80->busack = 1;
@@ -1339,13 +1462,13 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 						dputs("releasing z80 bus");
 						#ifdef DO_DEBUG_PRINT
 						char fname[20];
-						sprintf(fname, "zram-%d", zram_counter++);
+						sprintf(fname, "zram-%d", gen->zram_counter++);
 						FILE * f = fopen(fname, "wb");
 						fwrite(z80_ram, 1, sizeof(z80_ram), f);
 						fclose(f);
 						#endif
 					}
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_clear_busreq(gen->z80, context->cycles);
 					} else {
 						gen->z80->busack = 0;
@@ -1354,13 +1477,13 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 			} else if (masked == 0x11200) {
 				sync_z80(gen, context->cycles);
 				if (value & 1) {
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_clear_reset(gen->z80, context->cycles);
 					} else {
 						gen->z80->reset = 0;
 					}
 				} else {
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_assert_reset(gen->z80, context->cycles);
 					} else {
 						gen->z80->reset = 1;
@@ -1433,8 +1556,8 @@ static uint8_t io_read(uint32_t location, m68k_context * context)
 
 	if (location < 0x10000) {
 		//Access to Z80 memory incurs a one 68K cycle wait state
-		context->cycles += MCLKS_PER_68K;
-		if (!z80_enabled || z80_get_busack(gen->z80, context->cycles)) {
+		context->cycles += gen->mclks_per_68k;
+		if (!gen->z80_enabled || z80_get_busack(gen->z80, context->cycles)) {
 			location &= 0x7FFF;
 			if (location < 0x4000) {
 				value = gen->zram[location & 0x1FFF];
@@ -1510,7 +1633,7 @@ static uint8_t io_read(uint32_t location, m68k_context * context)
 		} else {
 			uint32_t masked = location & 0xFFF00;
 			if (masked == 0x11100) {
-				value = z80_enabled ? !z80_get_busack(gen->z80, context->cycles) : !gen->z80->busack;
+				value = gen->z80_enabled ? !z80_get_busack(gen->z80, context->cycles) : !gen->z80->busack;
 				value |= (get_open_bus_value(&gen->header) >> 8) & 0xFE;
 				dprintf("Byte read of BUSREQ returned %d @ %d (reset: %d)\n", value, context->cycles, gen->z80->reset);
 			} else if (masked == 0x11200) {
@@ -1732,7 +1855,7 @@ static uint8_t z80_read_bank(uint32_t location, void * vcontext)
 	//TODO: add cycle for an access right after a previous one
 	//TODO: Below cycle time is an estimate based on the time between 68K !BG goes low and Z80 !MREQ goes high
 	//      Needs a new logic analyzer capture to get the actual delay on the 68K side
-	gen->m68k->cycles += 8 * MCLKS_PER_68K;
+	gen->m68k->cycles += 8 * gen->mclks_per_68k;
 
 	location &= 0x7FFF;
 	if (context->mem_pointers[1]) {
@@ -1763,7 +1886,7 @@ static void *z80_write_bank(uint32_t location, void * vcontext, uint8_t value)
 	//TODO: add cycle for an access right after a previous one
 	//TODO: Below cycle time is an estimate based on the time between 68K !BG goes low and Z80 !MREQ goes high
 	//      Needs a new logic analyzer capture to get the actual delay on the 68K side
-	gen->m68k->cycles += 8 * MCLKS_PER_68K;
+	gen->m68k->cycles += 8 * gen->mclks_per_68k;
 
 	location &= 0x7FFF;
 	uint32_t address = gen->z80_bank_reg << 15 | location;
@@ -1795,10 +1918,10 @@ static uint16_t unused_read(uint32_t location, void *vcontext)
 	genesis_context *gen = context->system;
 	if (location >= 0x800000) {
 		//do refresh check here so we can avoid adding a penalty for a refresh that happens during an IO area access
-		gen->refresh_counter += context->cycles - 4*MCLKS_PER_68K - gen->last_sync_cycle;
-		context->cycles += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
-		gen->refresh_counter += 4*MCLKS_PER_68K;
-		gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+		gen->refresh_counter += context->cycles - 4*gen->mclks_per_68k - gen->last_sync_cycle;
+		context->cycles += REFRESH_DELAY * gen->mclks_per_68k * (gen->refresh_counter / (gen->mclks_per_68k * REFRESH_INTERVAL));
+		gen->refresh_counter += 4*gen->mclks_per_68k;
+		gen->refresh_counter = gen->refresh_counter % (gen->mclks_per_68k * REFRESH_INTERVAL);
 		gen->last_sync_cycle = context->cycles;
 	}
 
@@ -1858,10 +1981,10 @@ static void *unused_write(uint32_t location, void *vcontext, uint16_t value)
 	genesis_context *gen = context->system;
 	if (location >= 0x800000) {
 		//do refresh check here so we can avoid adding a penalty for a refresh that happens during an IO area access
-		gen->refresh_counter += context->cycles - 4*MCLKS_PER_68K - gen->last_sync_cycle;
-		context->cycles += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
-		gen->refresh_counter += 4*MCLKS_PER_68K;
-		gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+		gen->refresh_counter += context->cycles - 4*gen->mclks_per_68k - gen->last_sync_cycle;
+		context->cycles += REFRESH_DELAY * gen->mclks_per_68k * (gen->refresh_counter / (gen->mclks_per_68k * REFRESH_INTERVAL));
+		gen->refresh_counter += 4*gen->mclks_per_68k;
+		gen->refresh_counter = gen->refresh_counter % (gen->mclks_per_68k * REFRESH_INTERVAL);
 		gen->last_sync_cycle = context->cycles;
 	}
 
@@ -1927,6 +2050,8 @@ static void set_speed_percent(system_header * system, uint32_t percent)
 			segacd_context *cd = context->expansion;
 			segacd_set_speed_percent(cd, percent);
 		}
+		//render anything queued at the old clock rate
+		flush_deferred_sound(context);
 		ym_adjust_master_clock(context->ym, context->master_clock);
 	} else {
 		while (context->adpcm->cycle != context->psg->cycles) {
@@ -1984,9 +2109,58 @@ void set_region(genesis_context *gen, rom_info *info, uint8_t region)
 	gen->master_clock = gen->normal_clock;
 }
 
+static uint8_t load_rewind_state(genesis_context *gen)
+{
+	if (!gen->header.rewind || !rewind_available(gen->header.rewind)) {
+		return 0;
+	}
+#ifndef NEW_CORE
+	if (!gen->m68k->resume_pc) {
+		gen->header.delayed_load_slot = REWIND_SLOT + 1;
+		gen->m68k->should_return = 1;
+		return 1;
+	}
+#endif
+	size_t size;
+	uint8_t *data = rewind_pop(gen->header.rewind, &size);
+	deserialize(&gen->header, data, size);
+	//otherwise the older frame counter ends the frame right away and the whole history unwinds at once
+	gen->last_frame = gen->vdp->frame;
+	return 1;
+}
+
+static uint8_t load_runahead_state(genesis_context *gen)
+{
+	if (!gen->runahead_state.size) {
+		return 0;
+	}
+#ifndef NEW_CORE
+	if (!gen->m68k->resume_pc) {
+		gen->header.delayed_load_slot = RUNAHEAD_SLOT + 1;
+		gen->m68k->should_return = 1;
+		return 1;
+	}
+#endif
+	deserialize_buffer state;
+	init_deserialize(&state, gen->runahead_state.data, gen->runahead_state.size);
+	genesis_deserialize(&state, gen);
+	vdp_restore_output_position(gen->vdp);
+	//frame counter went back with the rest of the state, don't treat that as a frame end
+	gen->last_frame = gen->vdp->frame;
+	return 1;
+}
+
 static uint8_t load_state(system_header *system, uint8_t slot)
 {
 	genesis_context *gen = (genesis_context *)system;
+	if (slot == REWIND_SLOT) {
+		return load_rewind_state(gen);
+	}
+	if (slot == RUNAHEAD_SLOT) {
+		return load_runahead_state(gen);
+	}
+	system_runahead_cancel(system);
+	vdp_set_output_suppressed(gen->vdp, 0);
 	char *statepath = get_slot_name(system, slot, "state");
 	deserialize_buffer state;
 	uint32_t pc = 0;
@@ -2038,6 +2212,10 @@ static void handle_reset_requests(genesis_context *gen)
 			m68k_reset(gen->m68k);
 		}
 		if (gen->header.delayed_load_slot) {
+			if (gen->exit_requested && (gen->header.delayed_load_slot == RUNAHEAD_SLOT + 1 || gen->header.delayed_load_slot == REWIND_SLOT + 1)) {
+				//return the frame that was just presented first, resume_genesis will do the load
+				break;
+			}
 			load_state(&gen->header, gen->header.delayed_load_slot - 1);
 			gen->header.delayed_load_slot = 0;
 			resume_68k(gen->m68k);
@@ -2053,9 +2231,103 @@ static void handle_reset_requests(genesis_context *gen)
 	}
 }
 
+//The code cache remembers where the 68K started translating ROM code so that code can be translated
+//up front in the next session instead of in the middle of gameplay. Only 68K addresses are stored,
+//never native code, so a stale cache costs some translation time but can't affect emulation
+#define CODE_CACHE_FILE "code.cache"
+#define CODE_CACHE_MAGIC "BLSTCODE"
+#define CODE_CACHE_MAX_ENTRIES (0x1000000 / 2)
+
+typedef struct {
+	char     magic[8];
+	char     version[32];
+	uint8_t  sha1[20];
+	uint32_t num_entries;
+} code_cache_header;
+
+static uint8_t code_cache_enabled(genesis_context *gen)
+{
+	return gen->m68k->opts->entry_points && gen->header.save_dir && gen->cart;
+}
+
+static void load_code_cache(genesis_context *gen)
+{
+	if (!code_cache_enabled(gen)) {
+		return;
+	}
+	char *path = path_append(gen->header.save_dir, CODE_CACHE_FILE);
+	FILE *f = fopen(path, "rb");
+	free(path);
+	if (!f) {
+		return;
+	}
+	code_cache_header header;
+	if (
+		fread(&header, sizeof(header), 1, f) == 1
+		&& !memcmp(header.magic, CODE_CACHE_MAGIC, sizeof(header.magic))
+		&& !strncmp(header.version, BLASTEM_VERSION, sizeof(header.version))
+		&& !memcmp(header.sha1, gen->header.info.sha1, sizeof(header.sha1))
+		&& header.num_entries <= CODE_CACHE_MAX_ENTRIES
+	) {
+		uint32_t *entries = malloc(header.num_entries * sizeof(uint32_t));
+		if (fread(entries, sizeof(uint32_t), header.num_entries, f) == header.num_entries) {
+			m68k_pretranslate(gen->m68k, entries, header.num_entries);
+		}
+		free(entries);
+	}
+	fclose(f);
+}
+
+static int compare_entry_points(const void *a, const void *b)
+{
+	uint32_t left = *(const uint32_t *)a, right = *(const uint32_t *)b;
+	return left < right ? -1 : left > right;
+}
+
+static void save_code_cache(genesis_context *gen)
+{
+	if (!code_cache_enabled(gen)) {
+		return;
+	}
+	m68k_options *opts = gen->m68k->opts;
+	//code invalidated by a mapper will have been recorded again when it was retranslated
+	qsort(opts->entry_points, opts->num_entry_points, sizeof(uint32_t), compare_entry_points);
+	uint32_t unique = 0;
+	for (uint32_t i = 0; i < opts->num_entry_points; i++)
+	{
+		if (!unique || opts->entry_points[unique - 1] != opts->entry_points[i]) {
+			opts->entry_points[unique++] = opts->entry_points[i];
+		}
+	}
+	opts->num_entry_points = unique;
+	if (!unique) {
+		return;
+	}
+	code_cache_header header = {
+		.magic = CODE_CACHE_MAGIC,
+		.num_entries = unique
+	};
+	strncpy(header.version, BLASTEM_VERSION, sizeof(header.version));
+	memcpy(header.sha1, gen->header.info.sha1, sizeof(header.sha1));
+	char *path = path_append(gen->header.save_dir, CODE_CACHE_FILE);
+	FILE *f = fopen(path, "wb");
+	if (f) {
+		fwrite(&header, sizeof(header), 1, f);
+		fwrite(opts->entry_points, sizeof(uint32_t), unique, f);
+		fclose(f);
+	} else {
+		warning("Failed to open code cache %s for writing\n", path);
+	}
+	free(path);
+}
+
 static void start_genesis(system_header *system, char *statefile)
 {
 	genesis_context *gen = (genesis_context *)system;
+	load_code_cache(gen);
+	if (!strcmp("on", tern_find_path_default(config, "system\0aot_translation\0", (tern_val){.ptrval = "off"}, TVAL_PTR).ptrval)) {
+		m68k_aot_start(gen->m68k);
+	}
 	if (statefile) {
 		//first try loading as a native format savestate
 		deserialize_buffer state;
@@ -2131,6 +2403,11 @@ static void resume_genesis(system_header *system)
 		}
 		render_resume_source(gen->psg->audio);
 	}
+	gen->exit_requested = 0;
+	if (gen->header.delayed_load_slot == RUNAHEAD_SLOT + 1 || gen->header.delayed_load_slot == REWIND_SLOT + 1) {
+		load_state(&gen->header, gen->header.delayed_load_slot - 1);
+		gen->header.delayed_load_slot = 0;
+	}
 #ifdef NEW_CORE
 	while (!gen->m68k->should_return) {
 		if (gen->header.type == SYSTEM_PICO || gen->header.type == SYSTEM_COPERA) {
@@ -2156,14 +2433,40 @@ static void inc_debug_mode(system_header *system)
 static void request_exit(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
+	gen->exit_requested = 1;
 	gen->m68k->target_cycle = gen->m68k->cycles;
 	gen->m68k->should_return = 1;
 }
 
+static void suppress_audio(system_header *system, uint8_t suppress)
+{
+	genesis_context *gen = (genesis_context *)system;
+	if (gen->header.type == SYSTEM_PICO || gen->header.type == SYSTEM_COPERA) {
+		render_suppress_source(gen->adpcm->audio, suppress);
+		if (gen->ymz) {
+			render_suppress_source(gen->ymz->audio, suppress);
+		}
+	} else {
+		render_suppress_source(gen->ym->audio, suppress);
+	}
+	render_suppress_source(gen->psg->audio, suppress);
+	if (gen->expansion) {
+		segacd_context *cd = gen->expansion;
+		render_suppress_source(cd->pcm.audio, suppress);
+		render_suppress_source(cd->fader.audio, suppress);
+	}
+}
+
+static void set_rewinding(system_header *system, uint8_t rewinding)
+{
+	system->rewinding = rewinding && system->rewind;
+}
+
 static void persist_save(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
 	FILE *f;
+	save_code_cache(gen);
 	if (gen->expansion) {
 		segacd_context *cd = gen->expansion;
 		char *bram_name = path_append(system->save_dir, "internal.bram");
@@ -2278,6 +2581,8 @@ static void soft_reset(system_header *system)
 static void free_genesis(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
+	//the worker reads cartridge and Sega CD memory so it has to stop before any of it is freed
+	m68k_aot_stop(gen->m68k);
 	if (gen->expansion) {
 		free_segacd(gen->expansion);
 	}
@@ -2304,6 +2609,9 @@ static void free_genesis(system_header *system)
 		ym_free(gen->ym);
 	}
 	psg_free(gen->psg);
+	system_free_rewind(&gen->header);
+	free(gen->rewind_state.data);
+	free(gen->runahead_state.data);
 	free(gen->header.save_dir);
 	free_rom_info(&gen->header.info);
 	free(gen->lock_on);
@@ -2505,6 +2813,12 @@ static void set_audio_config(genesis_context *gen)
 			zero_offset = 1;
 		}
 		ym_enable_zero_offset(gen->ym, zero_offset);
+
+		char *deferred = tern_find_path_default(config, "audio\0deferred_sound\0", (tern_val){.ptrval="off"}, TVAL_PTR).ptrval;
+		//Sega CD audio is still rendered in step with the CPUs
+		uint8_t enable_deferred = !strcmp(deferred, "on") && !gen->expansion;
+		ym_enable_deferred(gen->ym, enable_deferred);
+		psg_enable_deferred(gen->psg, enable_deferred);
 	}
 
 	if (gen->expansion) {
@@ -2516,6 +2830,16 @@ static void set_audio_config(genesis_context *gen)
 	}
 }
 
+static void set_video_config(genesis_context *gen)
+{
+	char *deferred = tern_find_path_default(config, "video\0deferred_render\0", (tern_val){.ptrval="off"}, TVAL_PTR).ptrval;
+	//run-ahead reloads a state every frame and each load has to wait for the render thread
+	//and copy the whole VDP into it, which leaves nothing to gain from the pipeline
+	char *runahead = tern_find_path(config, "system\0runahead\0", TVAL_PTR).ptrval;
+	uint8_t runahead_on = runahead && atoi(runahead) > 0;
+	vdp_enable_pipeline(gen->vdp, !strcmp(deferred, "on") && !runahead_on);
+}
+
 static void config_updated(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
@@ -2523,6 +2847,7 @@ static void config_updated(system_header *system)
 		setup_io_devices(config, &system->info, &gen->io);
 	}
 	set_audio_config(gen);
+	set_video_config(gen);
 	//sample rate may have changed
 	if (gen->header.type != SYSTEM_PICO && gen->header.type != SYSTEM_COPERA) {
 		ym_adjust_master_clock(gen->ym, gen->master_clock);
@@ -2736,6 +3061,13 @@ static void *tmss_even_write_8(uint32_t address, void *context, uint8_t value)
 	return context;
 }
 
+static uint32_t get_m68k_divider(void)
+{
+	char *m68k_divider = tern_find_path(config, "clocks\0m68k_divider\0", TVAL_PTR).ptrval;
+	uint32_t divider = m68k_divider ? atoi(m68k_divider) : 0;
+	return divider ? divider : 7;
+}
+
 static genesis_context *shared_init(uint32_t system_opts, rom_info *rom, uint8_t force_region)
 {
 	static memmap_chunk z80_map[] = {
@@ -2746,16 +3078,9 @@ static genesis_context *shared_init(uint32_t system_opts, rom_info *rom, uint8_t
 		{ 0x7F00, 0x8000,  0x00FF, .read_8 = z80_vdp_port_read, .write_8 = z80_vdp_port_write}
 	};
 
-	char *m68k_divider = tern_find_path(config, "clocks\0m68k_divider\0", TVAL_PTR).ptrval;
-	if (!m68k_divider) {
-		m68k_divider = "7";
-	}
-	MCLKS_PER_68K = atoi(m68k_divider);
-	if (!MCLKS_PER_68K) {
-		MCLKS_PER_68K = 7;
-	}
-
 	genesis_context *gen = calloc(1, sizeof(genesis_context));
+	gen->mclks_per_68k = get_m68k_divider();
+	gen->z80_enabled = z80_enabled;
 	gen->header.set_speed_percent = set_speed_percent;
 	gen->header.start_context = start_genesis;
 	gen->header.resume_context = resume_genesis;
@@ -2766,6 +3091,8 @@ static genesis_context *shared_init(uint32_t system_opts, rom_info *rom, uint8_t
 	gen->header.free_context = free_genesis;
 	gen->header.get_open_bus_value = get_open_bus_value;
 	gen->header.request_exit = request_exit;
+	gen->header.suppress_audio = suppress_audio;
+	gen->header.set_rewinding = set_rewinding;
 	gen->header.inc_debug_mode = inc_debug_mode;
 	gen->header.gamepad_down = gamepad_down;
 	gen->header.gamepad_up = gamepad_up;
@@ -2778,6 +3105,7 @@ static genesis_context *shared_init(uint32_t system_opts, rom_info *rom, uint8_t
 	gen->header.config_updated = config_updated;
 	gen->header.serialize = serialize;
 	gen->header.deserialize = deserialize;
+	gen->header.serialize_into = serialize_into;
 	gen->header.start_vgm_log = start_vgm_log;
 	gen->header.stop_vgm_log = stop_vgm_log;
 	gen->header.toggle_debug_view = toggle_debug_view;
@@ -2798,8 +3126,8 @@ static genesis_context *shared_init(uint32_t system_opts, rom_info *rom, uint8_t
 	gen->frame_end = vdp_cycles_to_frame_end(gen->vdp);
 	char * config_cycles = tern_find_path(config, "clocks\0max_cycles\0", TVAL_PTR).ptrval;
 	gen->max_cycles = config_cycles ? atoi(config_cycles) : DEFAULT_SYNC_INTERVAL;
-	gen->int_latency_prev1 = MCLKS_PER_68K * 32;
-	gen->int_latency_prev2 = MCLKS_PER_68K * 16;
+	gen->int_latency_prev1 = gen->mclks_per_68k * 32;
+	gen->int_latency_prev2 = gen->mclks_per_68k * 16;
 
 	render_set_video_standard((gen->version_reg & HZ50) ? VID_PAL : VID_NTSC);
 	event_system_start(SYSTEM_GENESIS, (gen->version_reg & HZ50) ? VID_PAL : VID_NTSC, rom->name);
@@ -2887,14 +3215,6 @@ genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_o
 		byteswap_rom(nearest_pow2(lock_on_size), lock_on);
 	}
 #endif
-	char *m68k_divider = tern_find_path(config, "clocks\0m68k_divider\0", TVAL_PTR).ptrval;
-	if (!m68k_divider) {
-		m68k_divider = "7";
-	}
-	MCLKS_PER_68K = atoi(m68k_divider);
-	if (!MCLKS_PER_68K) {
-		MCLKS_PER_68K = 7;
-	}
 	genesis_context *gen = shared_init(ym_opts, &info, force_region);
 	gen->z80->mem_pointers[1] = gen->z80->mem_pointers[2] = rom;
 
@@ -3101,13 +3421,16 @@ genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_o
 	info.map = gen->header.info.map = NULL;
 
 	m68k_options *opts = malloc(sizeof(m68k_options));
-	init_m68k_opts(opts, map, map_chunks, MCLKS_PER_68K, sync_components, int_ack);
+	init_m68k_opts(opts, map, map_chunks, gen->mclks_per_68k, sync_components, int_ack);
 	if (!strcmp(tern_find_ptr_default(model, "tas", "broken"), "broken")) {
 		opts->gen.flags |= M68K_OPT_BROKEN_READ_MODIFY;
 	}
 	gen->m68k = init_68k_context(opts, NULL);
 	gen->m68k->system = gen;
 	opts->address_log = (ym_opts & OPT_ADDRESS_LOG) ? fopen("address.log", "w") : NULL;
+	if (!strcmp("on", tern_find_path_default(config, "system\0code_cache\0", (tern_val){.ptrval = "off"}, TVAL_PTR).ptrval)) {
+		m68k_track_entry_points(opts);
+	}
 
 	//This must happen after the 68K context has been allocated
 	for (int i = 0; i < map_chunks; i++)
@@ -3127,6 +3450,7 @@ genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_o
 	gen->reset_cycle = CYCLE_NEVER;
 
 	set_audio_config(gen);
+	set_video_config(gen);
 	return gen;
 }
 
@@ -3174,7 +3498,7 @@ genesis_context *alloc_config_genesis_cdboot(system_media *media, uint32_t syste
 	uint32_t num_chunks = cd_chunks + base_chunks;
 
 	m68k_options *opts = malloc(sizeof(m68k_options));
-	init_m68k_opts(opts, map, num_chunks, MCLKS_PER_68K, sync_components, int_ack);
+	init_m68k_opts(opts, map, num_chunks, gen->mclks_per_68k, sync_components, int_ack);
 	//TODO: make this configurable
 	opts->gen.flags |= M68K_OPT_BROKEN_READ_MODIFY;
 	gen->m68k = init_68k_context(opts, NULL);
@@ -3191,6 +3515,7 @@ genesis_context *alloc_config_genesis_cdboot(system_media *media, uint32_t syste
 	gen->header.type = SYSTEM_SEGACD;
 
 	set_audio_config(gen);
+	set_video_config(gen);
 	return gen;
 }
 
@@ -3221,15 +3546,9 @@ genesis_context* alloc_config_pico(void *rom, uint32_t rom_size, void *lock_on,
 		byteswap_rom(nearest_pow2(lock_on_size), lock_on);
 	}
 #endif
-	char *m68k_divider = tern_find_path(config, "clocks\0m68k_divider\0", TVAL_PTR).ptrval;
-	if (!m68k_divider) {
-		m68k_divider = "7";
-	}
-	MCLKS_PER_68K = atoi(m68k_divider);
-	if (!MCLKS_PER_68K) {
-		MCLKS_PER_68K = 7;
-	}
 	genesis_context *gen = calloc(1, sizeof(genesis_context));
+	gen->mclks_per_68k = get_m68k_divider();
+	gen->z80_enabled = z80_enabled;
 	gen->header.set_speed_percent = set_speed_percent;
 	gen->header.start_context = start_genesis;
 	gen->header.resume_context = resume_genesis;
@@ -3240,6 +3559,8 @@ genesis_context* alloc_config_pico(void *rom, uint32_t rom_size, void *lock_on,
 	gen->header.free_context = free_genesis;
 	gen->header.get_open_bus_value = get_open_bus_value;
 	gen->header.request_exit = request_exit;
+	gen->header.suppress_audio = suppress_audio;
+	gen->header.set_rewinding = set_rewinding;
 	gen->header.inc_debug_mode = inc_debug_mode;
 	gen->header.gamepad_down = gamepad_down_pico;
 	gen->header.gamepad_up = gamepad_up_pico;
@@ -3252,6 +3573,7 @@ genesis_context* alloc_config_pico(void *rom, uint32_t rom_size, void *lock_on,
 	gen->header.config_updated = config_updated;
 	gen->header.serialize = serialize;
 	gen->header.deserialize = deserialize;
+	gen->header.serialize_into = serialize_into;
 	gen->header.start_vgm_log = start_vgm_log;
 	gen->header.stop_vgm_log = stop_vgm_log;
 	gen->header.toggle_debug_view = toggle_debug_view;
@@ -3266,8 +3588,8 @@ genesis_context* alloc_config_pico(void *rom, uint32_t rom_size, void *lock_on,
 	gen->frame_end = vdp_cycles_to_frame_end(gen->vdp);
 	char * config_cycles = tern_find_path(config, "clocks\0max_cycles\0", TVAL_PTR).ptrval;
 	gen->max_cycles = config_cycles ? atoi(config_cycles) : DEFAULT_SYNC_INTERVAL;
-	gen->int_latency_prev1 = MCLKS_PER_68K * 32;
-	gen->int_latency_prev2 = MCLKS_PER_68K * 16;
+	gen->int_latency_prev1 = gen->mclks_per_68k * 32;
+	gen->int_latency_prev2 = gen->mclks_per_68k * 16;
 	
 	render_set_video_standard((gen->version_reg & 0x60) == 0x20 ? VID_PAL : VID_NTSC);
 	
@@ -3350,7 +3672,7 @@ genesis_context* alloc_config_pico(void *rom, uint32_t rom_size, void *lock_on,
 	info.map = gen->header.info.map = NULL;
 	
 	m68k_options *opts = malloc(sizeof(m68k_options));
-	init_m68k_opts(opts, map, map_chunks, MCLKS_PER_68K, sync_components_pico, int_ack);
+	init_m68k_opts(opts, map, map_chunks, gen->mclks_per_68k, sync_components_pico, int_ack);
 	//TODO: Pico model selection
 	//if (!strcmp(tern_find_ptr_default(model, "tas", "broken"), "broken")) {
 		opts->gen.flags |= M68K_OPT_BROKEN_READ_MODIFY;
@@ -3377,6 +3699,7 @@ genesis_context* alloc_config_pico(void *rom, uint32_t rom_size, void *lock_on,
 	gen->reset_cycle = CYCLE_NEVER;
 
 	set_audio_config(gen);
+	set_video_config(gen);
 	bindings_set_mouse_mode(MOUSE_ABSOLUTE);
 	memset(gen->pico_story_pages, 0xFF, sizeof(gen->pico_story_pages));
 #ifndef IS_LIB
@@ -55,9 +55,13 @@ struct genesis_context {
 	uint8_t         *tmss_buffer;
 	uint8_t         *serialize_tmp;
 	size_t          serialize_size;
+	serialize_buffer *serialize_dst; //caller provided buffer for serialize_into
+	serialize_buffer rewind_state;   //reused between rewind snapshots to avoid reallocating
+	serialize_buffer runahead_state; //state of the real timeline while run-ahead frames are emulated
 	uint32_t        num_eeprom;
 	uint32_t        save_size;
 	uint32_t        save_ram_mask;
+	uint32_t        mclks_per_68k;
 	uint32_t        master_clock; //Current master clock value
 	uint32_t        normal_clock; //Normal master clock (used to restore master clock after turbo mode)
 	uint32_t        frame_end;
@@ -71,6 +75,7 @@ struct genesis_context {
 	uint32_t        tmss_write_offset;
 	uint32_t        last_sync_cycle;
 	uint32_t        refresh_counter;
+	uint32_t        zram_counter; //suffix for the next zram dump file name
 	uint16_t        z80_bank_reg;
 	uint16_t        pico_pen_x;
 	uint16_t        pico_pen_y;
@@ -85,9 +90,11 @@ struct genesis_context {
 	uint8_t         pico_page;
 	uint8_t         bus_busy;
 	uint8_t         reset_requested;
+	uint8_t         exit_requested;
 	uint8_t         tmss;
 	uint8_t         vdp_unlocked;
 	uint8_t         enter_z80_debugger;
+	uint8_t         z80_enabled;
 	uint8_t         pico_story_window;
 	uint8_t         pico_story_pages[7];
 	eeprom_state    eeprom;
@@ -328,6 +328,8 @@ uint8_t vdp_load_gst(vdp_context * context, FILE * state_file)
 		context->vdpmem[i] = tmp_buf[i];
 		vdp_check_update_sat_byte(context, i, tmp_buf[i]);
 	}
+	vdp_invalidate_tile_cache(context);
+	vdp_resync_pipeline(context);
 	return 1;
 }
 
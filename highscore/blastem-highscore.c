@@ -17,6 +17,14 @@ struct _BlastemCore
 
   guint32 prev_input_state[2];
   guint32 input_state[2];
+
+  guint8 *state_buffer;
+  gsize state_buffer_size;
+
+  /* mixed audio for the current frame, in samples */
+  gint16 *audio_buffer;
+  gsize audio_buffer_len;
+  gsize audio_buffer_size;
 };
 
 #include "libblastem-highscore.c"
@@ -53,12 +61,15 @@ blastem_core_load_rom (HsCore      *core,
 
   g_assert (current_system);
 
+  system_init_rewind (current_system);
+  system_init_runahead (current_system);
+
   g_set_str (&current_system->save_dir, save_path);
   g_set_str (&save_filename, save_path);
 
   render_audio_initialized (RENDER_AUDIO_S16,
                             hs_core_get_sample_rate (core),
-                            2, 4, sizeof (int16_t));
+                            2, AUDIO_BUFFER_FRAMES, sizeof (int16_t));
 
   current_system->set_speed_percent (current_system, 100);
 
@@ -103,6 +114,19 @@ blastem_core_run_frame (HsCore *core)
     current_system->start_context (current_system, NULL);
     self->started = TRUE;
   }
+
+  flush_audio (self);
+}
+
+/* Steps back through the history kept when system.rewind is on, until
+ * called again with rewinding set to FALSE */
+void
+blastem_core_set_rewinding (BlastemCore *self, gboolean rewinding)
+{
+  g_return_if_fail (BLASTEM_IS_CORE (self));
+
+  if (current_system)
+    system_set_rewinding (current_system, rewinding);
 }
 
 static void
@@ -124,6 +148,12 @@ blastem_core_stop (HsCore *core)
 
   self->started = FALSE;
 
+  g_clear_pointer (&self->state_buffer, g_free);
+  self->state_buffer_size = 0;
+
+  g_clear_pointer (&self->audio_buffer, g_free);
+  self->audio_buffer_len = self->audio_buffer_size = 0;
+
   g_clear_pointer (&save_filename, g_free);
 }
 
@@ -156,12 +186,27 @@ blastem_core_save_state (HsCore          *core,
                          const char      *path,
                          HsStateCallback  callback)
 {
+  BlastemCore *self = BLASTEM_CORE (core);
   g_autoptr (GFile) file = g_file_new_for_path (path);
   size_t size;
-  g_autofree guint8 *data = current_system->serialize (current_system, &size);
   GError *error = NULL;
 
-  if (!g_file_replace_contents (file, data, size,
+  /* The buffer is kept around so repeated saves don't allocate */
+  size = system_serialize_into (current_system, self->state_buffer, self->state_buffer_size);
+  while (size > self->state_buffer_size) {
+    /* VDP FIFO contents can change the size slightly, leave some room */
+    self->state_buffer_size = size + 64;
+    self->state_buffer = g_realloc (self->state_buffer, self->state_buffer_size);
+    size = system_serialize_into (current_system, self->state_buffer, self->state_buffer_size);
+  }
+
+  if (!size) {
+    g_set_error (&error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Save states are not supported for this system");
+    callback (core, &error);
+    return;
+  }
+
+  if (!g_file_replace_contents (file, (char *) self->state_buffer, size,
                                 NULL, FALSE, G_FILE_CREATE_NONE,
                                 NULL, NULL, &error)) {
     callback (core, &error);
@@ -10,4 +10,6 @@ G_DECLARE_FINAL_TYPE (BlastemCore, blastem_core, BLASTEM, CORE, HsCore)
 
 G_MODULE_EXPORT GType hs_get_core_type (void);
 
+void blastem_core_set_rewinding (BlastemCore *self, gboolean rewinding);
+
 G_END_DECLS
@@ -18,6 +18,10 @@ system_header *current_system;
 
 static uint8_t last_fb;
 
+/* Upper bound on the per-source buffer, the actual sync threshold comes from AUDIO_SYNCS_PER_SEC */
+#define AUDIO_BUFFER_FRAMES 1024
+#define AUDIO_SYNCS_PER_SEC 240
+
 static uint32_t overscan_top, overscan_bot, overscan_left, overscan_right;
 static uint32_t last_width, last_height;
 
@@ -48,6 +52,11 @@ uint8_t render_get_active_framebuffer(void)
   return 0;
 }
 
+framebuffer_format render_framebuffer_format(uint8_t which)
+{
+  return FRAMEBUFFER_32BPP;
+}
+
 uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
 {
   BlastemCore *self = BLASTEM_CORE (core);
@@ -196,7 +205,8 @@ uint32_t render_min_buffered(void)
 
 uint32_t render_audio_syncs_per_sec(void)
 {
-  return 0;
+  /* mix in chunks of roughly a quarter frame, output is delivered once per frame regardless */
+  return AUDIO_SYNCS_PER_SEC;
 }
 
 void render_audio_created(audio_source *src)
@@ -211,13 +221,32 @@ void render_do_audio_ready(audio_source *src)
   src->front_populated = 1;
   src->buffer_pos = 0;
   if (all_sources_ready()) {
-    int16_t buffer[8];
+    BlastemCore *self = BLASTEM_CORE (core);
+    /* all sources are synced to the same threshold so they have the same amount ready */
+    gsize samples = src->read_end / src->num_channels * 2;
     int min_remaining_out;
-    mix_and_convert((uint8_t *)buffer, sizeof(buffer), &min_remaining_out);
-    hs_core_play_samples (HS_CORE (core), buffer, sizeof(buffer) / (sizeof(*buffer)));
+
+    if (self->audio_buffer_len + samples > self->audio_buffer_size) {
+      self->audio_buffer_size = (self->audio_buffer_len + samples) * 2;
+      self->audio_buffer = g_renew (gint16, self->audio_buffer, self->audio_buffer_size);
+    }
+
+    mix_and_convert ((uint8_t *) (self->audio_buffer + self->audio_buffer_len),
+                     samples * sizeof (gint16), &min_remaining_out);
+    self->audio_buffer_len += samples;
   }
 }
 
+static void
+flush_audio (BlastemCore *self)
+{
+  if (!self->audio_buffer_len)
+    return;
+
+  hs_core_play_samples (HS_CORE (self), self->audio_buffer, self->audio_buffer_len);
+  self->audio_buffer_len = 0;
+}
+
 void render_source_paused(audio_source *src, uint8_t remaining_sources)
 {
 }
@@ -134,6 +134,7 @@ RETRO_API void retro_get_system_info(struct retro_system_info *info)
 
 static vid_std video_standard;
 static uint32_t last_width, last_height;
+static framebuffer_format fb_format;
 static uint32_t overscan_top, overscan_bot, overscan_left, overscan_right;
 static void update_overscan(void)
 {
@@ -215,8 +216,11 @@ static size_t serialize_size_cache;
 RETRO_API size_t retro_serialize_size(void)
 {
 	if (!serialize_size_cache) {
-		uint8_t *tmp = current_system->serialize(current_system, &serialize_size_cache);
-		free(tmp);
+		serialize_size_cache = system_serialize_into(current_system, NULL, 0);
+		if (!serialize_size_cache) {
+			//save states are not supported for this system
+			return 0;
+		}
 		//VDP serialization size can vary based on FIFO fullness
 		//add a little fudge factor here to ensure the returned size is always >= the actual size
 		serialize_size_cache += 64;
@@ -231,14 +235,18 @@ RETRO_API size_t retro_serialize_size(void)
 RETRO_API bool retro_serialize(void *data, size_t size)
 {
 	size_t *buffer = data;
-	uint8_t *tmp = current_system->serialize(current_system, buffer);
-	if (*buffer > size) {
+	if (size < sizeof(size_t)) {
+		return 0;
+	}
+	//serialize directly into the frontend buffer so no allocation is needed for each call
+	*buffer = system_serialize_into(current_system, (uint8_t *)(buffer + 1), size - sizeof(size_t));
+	if (!*buffer) {
+		return 0;
+	}
+	if (*buffer > size - sizeof(size_t)) {
 		fprintf(stderr, "retro_serialize failed frontend size %d, actual size %d\n", (int)size, (int)*buffer);
-		free(tmp);
 		return 0;
 	}
-	memcpy(buffer + 1, tmp, *buffer);
-	free(tmp);
 	return 1;
 }
 
@@ -257,6 +265,24 @@ RETRO_API void retro_cheat_set(unsigned index, bool enabled, const char *code)
 {
 }
 
+//Not part of the libretro API, used by framebench to collect per-component timing
+//Only applies to the game that is currently loaded
+RETRO_API void blastem_set_profile(system_profile *profile)
+{
+	if (current_system) {
+		current_system->profile = profile;
+	}
+}
+
+//Not part of the libretro API, steps back through the history kept when system.rewind is on
+//Rewinding continues each frame until this is called with false
+RETRO_API void blastem_set_rewinding(bool rewinding)
+{
+	if (current_system) {
+		system_set_rewinding(current_system, rewinding);
+	}
+}
+
 /* Loads a game. */
 static system_type stype;
 RETRO_API bool retro_load_game(const struct retro_game_info *game)
@@ -278,10 +304,21 @@ RETRO_API bool retro_load_game(const struct retro_game_info *game)
 	if (stype == SYSTEM_UNKNOWN) {
 		stype = detect_system_type(&media);
 	}
+	//the VDP picks up the framebuffer format when it's created so this needs to be settled first
+	char *pixel_format = tern_find_path_default(config, "video\0pixel_format\0", (tern_val){.ptrval = "xrgb8888"}, TVAL_PTR).ptrval;
+	unsigned format = RETRO_PIXEL_FORMAT_RGB565;
+	if (!strcmp(pixel_format, "rgb565") && retro_environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format)) {
+		fb_format = FRAMEBUFFER_16BPP;
+	} else {
+		format = RETRO_PIXEL_FORMAT_XRGB8888;
+		retro_environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format);
+		fb_format = FRAMEBUFFER_32BPP;
+	}
 	current_system = alloc_config_system(stype, &media, 0, 0);
-
-	unsigned format = RETRO_PIXEL_FORMAT_XRGB8888;
-	retro_environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format);
+	if (current_system) {
+		system_init_rewind(current_system);
+		system_init_runahead(current_system);
+	}
 
 	return current_system != NULL;
 }
@@ -304,6 +341,7 @@ RETRO_API void retro_unload_game(void)
 	media.buffer = NULL;
 	current_system->free_context(current_system);
 	current_system = NULL;
+	started = 0;
 }
 
 /* Gets region of game. */
@@ -372,6 +410,9 @@ RETRO_API size_t retro_get_memory_size(unsigned id)
 //blastem render backend API implementation
 uint32_t render_map_color(uint8_t r, uint8_t g, uint8_t b)
 {
+	if (fb_format == FRAMEBUFFER_16BPP) {
+		return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+	}
 	return r << 16 | g << 8 | b;
 }
 
@@ -386,17 +427,27 @@ void render_destroy_window(uint8_t which)
 	//not supported in lib build
 }
 
+framebuffer_format render_framebuffer_format(uint8_t which)
+{
+	return fb_format;
+}
+
 static uint32_t fb[LINEBUF_SIZE * 294 * 2];
 static uint8_t last_fb;
+static uint32_t fb_line_bytes(void)
+{
+	return LINEBUF_SIZE * (fb_format == FRAMEBUFFER_16BPP ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
 uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
 {
-	*pitch = LINEBUF_SIZE * sizeof(uint32_t);
+	*pitch = fb_line_bytes();
 	if (which != last_fb) {
 		*pitch = *pitch * 2;
 	}
 
 	if (which) {
-		return fb + LINEBUF_SIZE;
+		return (uint32_t *)((uint8_t *)fb + fb_line_bytes());
 	} else {
 		return fb;
 	}
@@ -421,7 +472,8 @@ void render_framebuffer_updated(uint8_t which, int width)
 		last_width = width;
 		last_height = height;
 	}
-	retro_video_refresh(fb + overscan_left + LINEBUF_SIZE * overscan_top, width, height, LINEBUF_SIZE * sizeof(uint32_t));
+	uint32_t line_bytes = fb_line_bytes();
+	retro_video_refresh((uint8_t *)fb + overscan_left * line_bytes / LINEBUF_SIZE + line_bytes * overscan_top, width, height, line_bytes);
 	system_request_exit(current_system, 0);
 }
 
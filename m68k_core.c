@@ -14,6 +14,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 char disasm_buf[1024];
 
@@ -736,7 +737,12 @@ static void map_native_address(m68k_context * context, uint32_t address, code_pt
 		memset(native_code_map[chunk].offsets, 0xFF, sizeof(int32_t) * NATIVE_CHUNK_SIZE);
 	}
 	uint32_t offset = address % NATIVE_CHUNK_SIZE;
-	native_code_map[chunk].offsets[offset] = native_addr-native_code_map[chunk].base;
+	int32_t native_off = native_addr-native_code_map[chunk].base;
+	if (native_code_map[chunk].offsets[offset] != native_off) {
+		//retranslating in place doesn't use any more space
+		opts->gen.translated_bytes += native_size;
+	}
+	native_code_map[chunk].offsets[offset] = native_off;
 	for(address++,size-=1; size; address++,size-=1) {
 		address &= opts->gen.address_mask;
 		chunk = address / NATIVE_CHUNK_SIZE;
@@ -757,6 +763,11 @@ static uint8_t get_native_inst_size(m68k_options * opts, uint32_t address)
 {
 	uint32_t meta_off;
 	memmap_chunk const *chunk = find_map_chunk(address, &opts->gen, MMAP_CODE, &meta_off);
+	if (chunk && !(chunk->flags & MMAP_CODE)) {
+		//sizes are only tracked for code that can be overwritten, 0 makes
+		//m68k_retranslate_inst leave the old translation in place behind a jump
+		return 0;
+	}
 	if (chunk) {
 		meta_off += (address - chunk->start) & chunk->mask;
 	}
@@ -817,6 +828,18 @@ void insert_breakpoint(m68k_context * context, uint32_t address, debug_handler b
 			.handler = bp_handler,
 			.address = address
 		};
+		uint32_t lowest = address & context->opts->gen.address_mask;
+		memmap_chunk const *mem_chunk = find_map_chunk(lowest, &context->opts->gen, 0, NULL);
+		if (mem_chunk) {
+			//calculate the lowest alias for this address
+			lowest = mem_chunk->start + ((lowest - mem_chunk->start) & mem_chunk->mask);
+		}
+		m68k_disable_cycle_runs(context->opts, lowest, lowest + 2);
+		if (lowest >= 2) {
+			//the instruction before this one may have been translated with flag updates the
+			//breakpoint would now expose, retranslating it picks up the breakpoint
+			m68k_invalidate_code_range(context, lowest - 2, lowest);
+		}
 		m68k_breakpoint_patch(context, address, bp_handler, NULL);
 	}
 }
@@ -917,6 +940,8 @@ static void m68k_enable_watchpoints(m68k_context *context)
 	jmp(&code, new_write8);
 	context->opts->write_16 = new_write16;
 	context->opts->write_8 = new_write8;
+	//the new handlers need to survive a flush of the translation cache
+	set_code_flush_point(&context->opts->gen);
 }
 
 void m68k_add_watchpoint(m68k_context *context, uint32_t address, uint32_t size)
@@ -1075,21 +1100,10 @@ static impl_info m68k_impls[] = {
 	RAW_IMPL(M68K_TAS, translate_m68k_tas),
 };
 
-static void translate_m68k(m68k_context *context, m68kinst * inst)
+//translates everything but the cycle check at the start of the instruction
+static void translate_m68k_body(m68k_context *context, m68kinst * inst)
 {
 	m68k_options * opts = context->opts;
-	if (inst->address & 1) {
-		translate_m68k_odd(opts, inst);
-		return;
-	}
-	code_ptr start = opts->gen.code.cur;
-	check_cycles_int(&opts->gen, inst->address);
-
-	debug_handler bp;
-	if ((bp = find_breakpoint(context, inst->address))) {
-		m68k_breakpoint_patch(context, inst->address, bp, start);
-	}
-
 	//log_address(&opts->gen, inst->address, opts->gen.clock_divider == 4 ? "Sub M68k: %X @ %d\n" : "Main M68K: %X @ %d\n");
 	if (
 		(inst->src.addr_mode > MODE_AREG && inst->src.addr_mode < MODE_IMMEDIATE)
@@ -1132,12 +1146,528 @@ static void translate_m68k(m68k_context *context, m68kinst * inst)
 	}
 }
 
+static void translate_m68k(m68k_context *context, m68kinst * inst)
+{
+	m68k_options * opts = context->opts;
+	if (inst->address & 1) {
+		translate_m68k_odd(opts, inst);
+		return;
+	}
+	code_ptr start = opts->gen.code.cur;
+	check_cycles_int(&opts->gen, inst->address);
+
+	debug_handler bp;
+	if ((bp = find_breakpoint(context, inst->address))) {
+		m68k_breakpoint_patch(context, inst->address, bp, start);
+	}
+	translate_m68k_body(context, inst);
+}
+
 uint16_t m68k_instruction_fetch(uint32_t address, void *vcontext)
 {
 	m68k_context *context = vcontext;
 	return read_word(address, (void **)context->mem_pointers, &context->opts->gen, context);
 }
 
+//returns the CCR bits inst sets without depending on their previous values
+static uint8_t m68k_overwritten_flags(m68kinst *inst)
+{
+	switch (inst->op)
+	{
+	case M68K_ADD:
+	case M68K_SUB:
+		return inst->dst.addr_mode == MODE_AREG ? 0 : 0x1F;
+	case M68K_NEG:
+		return 0x1F;
+	case M68K_ASL:
+	case M68K_ASR:
+	case M68K_LSL:
+	case M68K_LSR:
+		//a register shift count of zero leaves X alone
+		return inst->src.addr_mode == MODE_IMMEDIATE ? 0x1F : 0xF;
+	case M68K_MOVE:
+		return inst->dst.addr_mode == MODE_AREG ? 0 : 0xF;
+	case M68K_AND:
+	case M68K_OR:
+	case M68K_EOR:
+	case M68K_CMP:
+	case M68K_TST:
+	case M68K_CLR:
+	case M68K_NOT:
+	case M68K_SWAP:
+	case M68K_EXT:
+	case M68K_MULS:
+	case M68K_MULU:
+	case M68K_ROL:
+	case M68K_ROR:
+		return 0xF;
+	default:
+		return 0;
+	}
+}
+
+//operands that can't raise an address error or trip a watchpoint
+static uint8_t m68k_reg_or_immed(m68k_op_info *op)
+{
+	return op->addr_mode == MODE_REG || op->addr_mode == MODE_AREG || op->addr_mode >= MODE_IMMEDIATE;
+}
+
+//Flag updates for inst can be skipped when the instruction after it overwrites them.
+//The flags are only stale in the window between the two instructions (an interrupt taken there
+//will stack them) so this is limited to simple ops in code that can't be rewritten under us.
+//The next instruction must not access memory either, otherwise an address error or a watchpoint
+//could expose the stale flags before it overwrites them
+static uint8_t m68k_dead_flags(m68k_context *context, memmap_chunk const *chunk, m68kinst *inst, uint32_t next_address)
+{
+	switch (inst->op)
+	{
+	case M68K_ADD:
+	case M68K_SUB:
+	case M68K_AND:
+	case M68K_OR:
+	case M68K_EOR:
+	case M68K_CMP:
+	case M68K_NEG:
+	case M68K_NOT:
+	case M68K_TST:
+	case M68K_CLR:
+	case M68K_SWAP:
+	case M68K_EXT:
+	case M68K_MOVE:
+		break;
+	default:
+		return 0;
+	}
+	if ((chunk->flags & MMAP_CODE) || (inst->address & 1) || (next_address & 1)) {
+		return 0;
+	}
+	if (find_map_chunk(next_address, &context->opts->gen, 0, NULL) != chunk || find_breakpoint(context, next_address)) {
+		return 0;
+	}
+	m68kinst next;
+	m68k_decode(m68k_instruction_fetch, context, &next, next_address);
+	if (!m68k_reg_or_immed(&next.src) || !m68k_reg_or_immed(&next.dst)) {
+		return 0;
+	}
+	return m68k_overwritten_flags(&next);
+}
+
+//Only plain ROM is worth remembering, anything writable or banked may hold different code next time
+static uint8_t is_static_code(memmap_chunk const *chunk)
+{
+	return chunk && chunk->buffer && (chunk->flags & (MMAP_READ|MMAP_WRITE|MMAP_CODE|MMAP_PTR_IDX)) == MMAP_READ;
+}
+
+static void add_entry_point(m68k_options *opts, uint32_t address)
+{
+	if (!is_static_code(find_map_chunk(address, &opts->gen, 0, NULL))) {
+		return;
+	}
+	if (opts->num_entry_points == opts->entry_point_storage) {
+		opts->entry_point_storage *= 2;
+		opts->entry_points = realloc(opts->entry_points, opts->entry_point_storage * sizeof(uint32_t));
+	}
+	opts->entry_points[opts->num_entry_points++] = address;
+}
+
+void m68k_track_entry_points(m68k_options *opts)
+{
+	if (!opts->entry_points) {
+		opts->entry_point_storage = 1024;
+		opts->entry_points = malloc(opts->entry_point_storage * sizeof(uint32_t));
+	}
+}
+
+//Translates code ahead of time from a list of entry points recorded with m68k_track_entry_points
+//in a previous session so it doesn't need to happen while the game is running
+void m68k_pretranslate(m68k_context *context, uint32_t *addresses, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t address = addresses[i] & context->opts->gen.address_mask;
+		if (!(address & 1) && is_static_code(find_map_chunk(address, &context->opts->gen, 0, NULL))) {
+			translate_m68k_stream(address, context);
+		}
+	}
+}
+
+//Ahead of time translation: a worker thread walks ROM code statically from the vector table to find
+//code the lazy translator won't reach through direct branches (interrupt/trap handlers and jump tables).
+//The native code buffers and maps aren't thread safe so the emulation thread still does the actual
+//translation, a small batch per frame via m68k_aot_install
+#define AOT_PUBLISH 0x80000000
+#define AOT_MAX_TABLE 256
+//straight line code longer than this is probably data
+#define AOT_MAX_BLOCK 4096
+#define AOT_INSTALL_BATCH 16
+
+struct m68k_aot {
+	m68k_options    *opts;
+	uint8_t         *visited;
+	uint32_t        *pending;
+	uint32_t        num_pending;
+	uint32_t        pending_storage;
+	uint32_t        *found;
+	uint32_t        num_found;
+	uint32_t        found_storage;
+	uint32_t        installed;
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	uint8_t         quit;
+};
+
+static uint16_t aot_fetch(uint32_t address, void *vopts)
+{
+	m68k_options *opts = vopts;
+	//never touch anything with side effects or mutable mappings from the worker
+	if (!is_static_code(find_map_chunk(address, &opts->gen, 0, NULL))) {
+		return 0xFFFF;
+	}
+	return read_word(address, NULL, &opts->gen, NULL);
+}
+
+static void aot_push(m68k_aot *aot, uint32_t address, uint32_t publish)
+{
+	address &= aot->opts->gen.address_mask;
+	if ((address & 1) || !is_static_code(find_map_chunk(address, &aot->opts->gen, 0, NULL))) {
+		return;
+	}
+	if (aot->num_pending == aot->pending_storage) {
+		aot->pending_storage = aot->pending_storage ? aot->pending_storage * 2 : 256;
+		aot->pending = realloc(aot->pending, aot->pending_storage * sizeof(uint32_t));
+	}
+	aot->pending[aot->num_pending++] = address | publish;
+}
+
+static void aot_publish(m68k_aot *aot, uint32_t address)
+{
+	pthread_mutex_lock(&aot->lock);
+	if (aot->num_found == aot->found_storage) {
+		aot->found_storage = aot->found_storage ? aot->found_storage * 2 : 256;
+		aot->found = realloc(aot->found, aot->found_storage * sizeof(uint32_t));
+	}
+	aot->found[aot->num_found++] = address;
+	pthread_mutex_unlock(&aot->lock);
+}
+
+//Handles the two common jump table idioms, jmp/jsr table(pc,dn) into a list of branches and
+//move.w table(pc,dn),dm followed by jmp/jsr table(pc,dm) with a list of offsets from the table
+static void aot_scan_table(m68k_aot *aot, m68kinst *inst, m68kinst *prev)
+{
+	uint32_t base = inst->address + 2 + inst->src.params.regs.displacement;
+	if (
+		prev->op == M68K_MOVE && prev->extra.size == OPSIZE_WORD && prev->src.addr_mode == MODE_PC_INDEX_DISP8
+		&& prev->address + 2 + prev->src.params.regs.displacement == base
+	) {
+		uint32_t limit = base + AOT_MAX_TABLE * 2;
+		for (uint32_t entry = base; entry < limit; entry += 2)
+		{
+			uint32_t target = base + (int16_t)aot_fetch(entry, aot->opts);
+			if ((target & 1) || (target >= base && target <= entry) || !is_static_code(find_map_chunk(target, &aot->opts->gen, 0, NULL))) {
+				break;
+			}
+			aot_push(aot, target, AOT_PUBLISH);
+			//the routines usually follow the table so the first one marks its end
+			if (target > entry && target < limit) {
+				limit = target;
+			}
+		}
+		return;
+	}
+	m68kinst entry;
+	uint32_t address = base;
+	for (int i = 0; i < AOT_MAX_TABLE; i++)
+	{
+		uint32_t next = m68k_decode(aot_fetch, aot->opts, &entry, address);
+		if (entry.op == M68K_BCC && entry.extra.cond == COND_TRUE) {
+			aot_push(aot, entry.address + 2 + entry.src.params.immed, AOT_PUBLISH);
+		} else if (entry.op == M68K_JMP && (entry.src.addr_mode == MODE_ABSOLUTE || entry.src.addr_mode == MODE_ABSOLUTE_SHORT)) {
+			aot_push(aot, entry.src.params.immed, AOT_PUBLISH);
+		} else {
+			break;
+		}
+		address = next;
+	}
+}
+
+//Returns 0 if the code doesn't look like code, anything it would have queued is dropped
+static uint8_t aot_walk(m68k_aot *aot, uint32_t address)
+{
+	m68kinst inst, prev = {.op = M68K_INVALID};
+	uint32_t first_pending = aot->num_pending;
+	for (uint32_t count = 0;; count++)
+	{
+		uint32_t bit = address >> 1;
+		if (aot->visited[bit >> 3] & 1 << (bit & 7)) {
+			return 1;
+		}
+		aot->visited[bit >> 3] |= 1 << (bit & 7);
+		uint32_t next = m68k_decode(aot_fetch, aot->opts, &inst, address);
+		if (inst.op == M68K_INVALID || inst.op == M68K_ILLEGAL || count == AOT_MAX_BLOCK) {
+			aot->num_pending = first_pending;
+			return 0;
+		}
+		switch (inst.op)
+		{
+		case M68K_BCC:
+		case M68K_BSR:
+		case M68K_DBCC:
+			aot_push(aot, inst.address + 2 + inst.src.params.immed, 0);
+			break;
+		case M68K_JMP:
+		case M68K_JSR:
+			if (inst.src.addr_mode == MODE_ABSOLUTE || inst.src.addr_mode == MODE_ABSOLUTE_SHORT) {
+				aot_push(aot, inst.src.params.immed, 0);
+			} else if (inst.src.addr_mode == MODE_PC_DISPLACE) {
+				aot_push(aot, inst.address + 2 + inst.src.params.regs.displacement, 0);
+			} else if (inst.src.addr_mode == MODE_PC_INDEX_DISP8) {
+				aot_scan_table(aot, &inst, &prev);
+			}
+			break;
+		}
+		if (m68k_is_terminal(&inst) || (next & 1) || !is_static_code(find_map_chunk(next, &aot->opts->gen, 0, NULL))) {
+			return 1;
+		}
+		prev = inst;
+		address = next;
+	}
+}
+
+static void *aot_worker(void *data)
+{
+	m68k_aot *aot = data;
+	m68k_options *opts = aot->opts;
+	aot_push(aot, aot_fetch(VECTOR_RESET_PC * 4, opts) << 16 | aot_fetch(VECTOR_RESET_PC * 4 + 2, opts), 0);
+	for (uint32_t vector = VECTOR_INT_1; vector <= VECTOR_TRAP_15; vector++)
+	{
+		uint32_t target = aot_fetch(vector * 4, opts) << 16 | aot_fetch(vector * 4 + 2, opts);
+		if (target >= VECTOR_USER0 * 4) {
+			aot_push(aot, target, AOT_PUBLISH);
+		}
+	}
+	while (aot->num_pending && !__atomic_load_n(&aot->quit, __ATOMIC_RELAXED))
+	{
+		uint32_t address = aot->pending[--aot->num_pending];
+		uint32_t bit = (address & ~AOT_PUBLISH) >> 1;
+		uint8_t seen = aot->visited[bit >> 3] & 1 << (bit & 7);
+		if (aot_walk(aot, address & ~AOT_PUBLISH) && (address & AOT_PUBLISH) && !seen) {
+			aot_publish(aot, address & ~AOT_PUBLISH);
+		}
+	}
+	return NULL;
+}
+
+void m68k_aot_start(m68k_context *context)
+{
+	m68k_options *opts = context->opts;
+	if (opts->aot) {
+		return;
+	}
+	m68k_aot *aot = calloc(1, sizeof(m68k_aot));
+	aot->opts = opts;
+	aot->visited = calloc(((opts->gen.address_mask + 1) >> 4) + 1, 1);
+	pthread_mutex_init(&aot->lock, NULL);
+	if (pthread_create(&aot->thread, NULL, aot_worker, aot)) {
+		warning("Failed to start ahead of time translation thread\n");
+		pthread_mutex_destroy(&aot->lock);
+		free(aot->visited);
+		free(aot);
+		return;
+	}
+	opts->aot = aot;
+}
+
+static void aot_stop(m68k_aot *aot)
+{
+	__atomic_store_n(&aot->quit, 1, __ATOMIC_RELAXED);
+	pthread_join(aot->thread, NULL);
+	pthread_mutex_destroy(&aot->lock);
+	free(aot->visited);
+	free(aot->pending);
+	free(aot->found);
+	free(aot);
+}
+
+void m68k_aot_stop(m68k_context *context)
+{
+	if (context->opts->aot) {
+		aot_stop(context->opts->aot);
+		context->opts->aot = NULL;
+	}
+}
+
+void m68k_aot_install(m68k_context *context)
+{
+	m68k_aot *aot = context->opts->aot;
+	if (!aot) {
+		return;
+	}
+	uint32_t batch[AOT_INSTALL_BATCH];
+	uint32_t count = 0;
+	pthread_mutex_lock(&aot->lock);
+	while (count < AOT_INSTALL_BATCH && aot->installed < aot->num_found)
+	{
+		batch[count++] = aot->found[aot->installed++];
+	}
+	pthread_mutex_unlock(&aot->lock);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		translate_m68k_stream(batch[i], context);
+	}
+}
+
+//Runs shorter than this don't save enough checks to pay for the guard
+#define MIN_CYCLE_RUN 3
+#define MAX_CYCLE_RUN 8
+
+//Register only instructions with a fixed cycle cost never look at the cycle count or the limit
+//so the checks between them can be combined into one at the start of a run
+static uint8_t fixed_cost_reg_op(m68k_context *context, m68kinst *inst)
+{
+	switch (inst->op)
+	{
+	case M68K_ADD:
+	case M68K_SUB:
+	case M68K_AND:
+	case M68K_OR:
+	case M68K_EOR:
+	case M68K_CMP:
+	case M68K_NEG:
+	case M68K_NOT:
+	case M68K_TST:
+	case M68K_CLR:
+	case M68K_SWAP:
+	case M68K_EXT:
+	case M68K_EXG:
+	case M68K_MOVE:
+		break;
+	default:
+		return 0;
+	}
+	if (
+		(inst->src.addr_mode > MODE_AREG && inst->src.addr_mode < MODE_IMMEDIATE)
+		|| (inst->dst.addr_mode > MODE_AREG && inst->dst.addr_mode < MODE_IMMEDIATE)
+	) {
+		return 0;
+	}
+	return !(inst->address & 1) && !find_breakpoint(context, inst->address);
+}
+
+static void add_cycle_run(m68k_options *opts, code_ptr guard, uint32_t start, uint32_t end)
+{
+	if (opts->num_cycle_runs == opts->cycle_run_storage) {
+		opts->cycle_run_storage = opts->cycle_run_storage ? opts->cycle_run_storage * 2 : 256;
+		opts->cycle_runs = realloc(opts->cycle_runs, opts->cycle_run_storage * sizeof(cycle_run));
+	}
+	if (!opts->num_cycle_runs || start < opts->cycle_runs_low) {
+		opts->cycle_runs_low = start;
+	}
+	if (!opts->num_cycle_runs || end > opts->cycle_runs_high) {
+		opts->cycle_runs_high = end;
+	}
+	opts->cycle_runs[opts->num_cycle_runs++] = (cycle_run){
+		.guard = guard,
+		.start = start,
+		.end = end
+	};
+}
+
+//Sends runs overlapping start-end down their checked copy for good, used when something
+//needs to patch one of the instructions in the middle of a run
+void m68k_disable_cycle_runs(m68k_options *opts, uint32_t start, uint32_t end)
+{
+	if (!opts->num_cycle_runs || end <= opts->cycle_runs_low || start >= opts->cycle_runs_high) {
+		return;
+	}
+	for (uint32_t i = 0; i < opts->num_cycle_runs;)
+	{
+		if (opts->cycle_runs[i].start < end && start < opts->cycle_runs[i].end) {
+			m68k_cycle_run_disable(opts->cycle_runs[i].guard);
+			opts->cycle_runs[i] = opts->cycle_runs[--opts->num_cycle_runs];
+		} else {
+			i++;
+		}
+	}
+}
+
+//Translates a run of fixed cost register only instructions starting with inst that checks
+//the cycle limit once for the whole run. The run is translated twice, once without the checks
+//between instructions and once as usual. The guard at the start only takes the unchecked copy
+//when none of the checks it skips could fire. Only the checked copy is mapped so jumps into the
+//middle of a run and patches for breakpoints see normal instructions.
+//Returns the address after the run or 0 if there isn't a long enough run at inst
+static uint32_t translate_m68k_run(m68k_context *context, memmap_chunk const *chunk, m68kinst *inst, uint32_t next_address)
+{
+	m68k_options *opts = context->opts;
+	code_info *code = &opts->gen.code;
+	m68kinst run[MAX_CYCLE_RUN];
+	uint32_t ends[MAX_CYCLE_RUN];
+	uint8_t dead_flags[MAX_CYCLE_RUN];
+	if (!is_static_code(chunk) || !fixed_cost_reg_op(context, inst)) {
+		return 0;
+	}
+	run[0] = *inst;
+	ends[0] = next_address;
+	uint32_t count = 1;
+	while (count < MAX_CYCLE_RUN)
+	{
+		uint32_t address = ends[count-1];
+		if (find_map_chunk(address, &opts->gen, 0, NULL) != chunk || get_native_address(opts, address)) {
+			break;
+		}
+		ends[count] = m68k_decode(m68k_instruction_fetch, context, run + count, address);
+		if (!fixed_cost_reg_op(context, run + count)) {
+			break;
+		}
+		count++;
+	}
+	if (count < MIN_CYCLE_RUN) {
+		return 0;
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		dead_flags[i] = m68k_dead_flags(context, chunk, run + i, ends[i]);
+	}
+
+	code_ptr start = code->cur;
+	check_cycles_int(&opts->gen, run[0].address);
+	uint32_t *skipped_cycles;
+	code_ptr guard = m68k_cycle_run_guard(opts, &skipped_cycles);
+	opts->gen.batch_cycles = 1;
+	opts->gen.cycle_batch = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (i == count - 1) {
+			//the check after the last instruction isn't skipped
+			*skipped_cycles = opts->gen.cycle_batch;
+		}
+		opts->dead_flags = dead_flags[i];
+		translate_m68k_body(context, run + i);
+	}
+	opts->gen.batch_cycles = 0;
+	code_ptr exit = m68k_cycle_run_exit(opts, opts->gen.cycle_batch);
+
+	m68k_cycle_run_link(guard, code->cur);
+	opts->dead_flags = dead_flags[0];
+	translate_m68k_body(context, run);
+	map_native_address(context, run[0].address, start, ends[0] - run[0].address, code->cur - start);
+	for (uint32_t i = 1; i < count; i++)
+	{
+		check_code_prologue(code);
+		code_ptr inst_start = code->cur;
+		opts->dead_flags = dead_flags[i];
+		translate_m68k(context, run + i);
+		map_native_address(context, run[i].address, inst_start, ends[i] - run[i].address, code->cur - inst_start);
+	}
+	opts->dead_flags = 0;
+	m68k_cycle_run_link(exit, code->cur);
+	//calculate the lowest alias for this address
+	uint32_t lowest = chunk->start + ((run[0].address - chunk->start) & chunk->mask);
+	add_cycle_run(opts, guard, lowest, lowest + ends[count-1] - run[0].address);
+	*inst = run[count-1];
+	return ends[count-1];
+}
+
 void translate_m68k_stream(uint32_t address, m68k_context * context)
 {
 	m68kinst instbuf;
@@ -1153,6 +1683,9 @@ void translate_m68k_stream(uint32_t address, m68k_context * context)
 			fprintf(opts->address_log, "%X\n", address);
 			fflush(opts->address_log);
 		}
+		if (opts->entry_points) {
+			add_entry_point(opts, address);
+		}
 		do {
 			code_ptr existing = get_native_address(opts, address);
 			if (existing) {
@@ -1200,8 +1733,15 @@ void translate_m68k_stream(uint32_t address, m68k_context * context)
 
 			//make sure the beginning of the code for an instruction is contiguous
 			check_code_prologue(code);
+			uint32_t run_end = translate_m68k_run(context, chunk, &instbuf, address);
+			if (run_end) {
+				address = run_end;
+				continue;
+			}
 			code_ptr start = code->cur;
+			opts->dead_flags = m68k_dead_flags(context, chunk, &instbuf, address);
 			translate_m68k(context, &instbuf);
+			opts->dead_flags = 0;
 			code_ptr after = code->cur;
 			map_native_address(context, instbuf.address, start, m68k_size, after-start);
 		} while(!m68k_is_terminal(&instbuf) && !(address & 1));
@@ -1257,6 +1797,8 @@ void * m68k_retranslate_inst(uint32_t address, m68k_context * context)
 		}*/
 
 		map_native_address(context, instbuf.address, native_start, after_address - orig, MAX_NATIVE_SIZE);
+		//the original translation is now just a jump to the new one
+		opts->gen.dead_bytes += orig_size;
 
 		jmp(&orig_code, native_start);
 		if (!m68k_is_terminal(&instbuf)) {
@@ -1290,6 +1832,23 @@ void * m68k_retranslate_inst(uint32_t address, m68k_context * context)
 	}
 }
 
+m68k_context *m68k_check_code_flush(m68k_context *context)
+{
+	m68k_options *opts = context->opts;
+	if (code_flush_needed(&opts->gen)) {
+		debug_message("Flushing 68K code cache, %u of %u KB dead\n", opts->gen.dead_bytes / 1024, opts->gen.translated_bytes / 1024);
+		flush_code(&opts->gen, context, NATIVE_MAP_CHUNKS);
+	}
+	return context;
+}
+
+//cycle runs point at translated code so they go away with it
+void m68k_code_flushed(void *vcontext)
+{
+	m68k_context *context = vcontext;
+	context->opts->num_cycle_runs = 0;
+}
+
 code_ptr get_native_address_trans(m68k_context * context, uint32_t address)
 {
 	code_ptr ret = get_native_address(context->opts, address);
@@ -1350,6 +1909,7 @@ void m68k_reset(m68k_context * context)
 		context->aregs[8] = context->aregs[7];
 	}
 	context->resume_pc = NULL;
+	context->stopped = 0;
 	context->stack_storage_count = 0;
 	context->status = 0x27;
 	context->aregs[7] = ((uint32_t)reset_vec[0]) << 16 | reset_vec[1];
@@ -1375,7 +1935,13 @@ void m68k_options_free(m68k_options *opts)
 		free(opts->gen.ram_inst_sizes[i]);
 	}
 	free(opts->gen.ram_inst_sizes);
+	free_code_pool(&opts->gen.code);
 	free(opts->big_movem);
+	if (opts->aot) {
+		aot_stop(opts->aot);
+	}
+	free(opts->entry_points);
+	free(opts->cycle_runs);
 	free(opts);
 }
 
@@ -1439,5 +2005,6 @@ void m68k_deserialize(deserialize_buffer *buf, void *vcontext)
 	context->int_num = load_int8(buf);
 	context->int_pending = load_int8(buf);
 	context->trace_pending = load_int8(buf);
+	context->stopped = 0;
 	context->stack_storage_count = 0;
 }
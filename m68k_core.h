@@ -26,6 +26,7 @@ typedef struct m68kinst m68kinst;
 
 typedef void (*start_fun)(uint8_t * addr, void * context);
 typedef struct m68k_context m68k_context;
+typedef struct m68k_aot m68k_aot;
 typedef m68k_context *(*sync_fun)(m68k_context * context, uint32_t address);
 typedef m68k_context *(*int_ack_fun)(m68k_context * context);
 
@@ -37,12 +38,19 @@ typedef struct {
 	int8_t   dir;
 } movem_fun;
 
+typedef struct {
+	code_ptr guard; //branch to the copy with per-instruction cycle checks
+	uint32_t start;
+	uint32_t end;
+} cycle_run;
+
 typedef struct {
 	cpu_options     gen;
 
 	int8_t          dregs[8];
 	int8_t          aregs[9];
 	int8_t			flag_regs[5];
+	uint8_t         dead_flags; //CCR bits the next instruction overwrites without reading them
 	FILE            *address_log;
 	code_ptr        read_16;
 	code_ptr        write_16;
@@ -70,6 +78,15 @@ typedef struct {
 	movem_fun       *big_movem;
 	uint32_t        num_movem;
 	uint32_t        movem_storage;
+	cycle_run       *cycle_runs;
+	uint32_t        num_cycle_runs;
+	uint32_t        cycle_run_storage;
+	uint32_t        cycle_runs_low; //address range covered by cycle_runs, for rejecting invalidations quickly
+	uint32_t        cycle_runs_high;
+	uint32_t        *entry_points; //ROM addresses translation was started from, only tracked when non-NULL
+	uint32_t        num_entry_points;
+	uint32_t        entry_point_storage;
+	m68k_aot        *aot;
 	code_word       prologue_start;
 } m68k_options;
 
@@ -119,6 +136,7 @@ struct m68k_context {
 	uint8_t         wp_hit;
 	uint8_t         int_pending;
 	uint8_t         trace_pending;
+	uint8_t         stopped; //a STOP instruction is waiting for an interrupt
 	uint8_t         should_return;
 	uint8_t         stack_storage_count;
 	uint8_t         ram_code_flags[];
@@ -134,6 +152,11 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 m68k_context * init_68k_context(m68k_options * opts, m68k_reset_handler reset_handler);
 void m68k_reset(m68k_context * context);
 void m68k_options_free(m68k_options *opts);
+void m68k_track_entry_points(m68k_options *opts);
+void m68k_pretranslate(m68k_context *context, uint32_t *addresses, uint32_t count);
+void m68k_aot_start(m68k_context *context);
+void m68k_aot_install(m68k_context *context);
+void m68k_aot_stop(m68k_context *context);
 void insert_breakpoint(m68k_context * context, uint32_t address, debug_handler bp_handler);
 void remove_breakpoint(m68k_context * context, uint32_t address);
 void m68k_add_watchpoint(m68k_context *context, uint32_t address, uint32_t size);
@@ -108,6 +108,19 @@ void flag_to_flag(m68k_options *opts, uint8_t flag1, uint8_t flag2)
 void update_flags(m68k_options *opts, uint32_t update_mask)
 {
 	uint8_t native_flags[] = {0, CC_S, CC_Z, CC_O, CC_C};
+	if (opts->dead_flags) {
+		uint8_t dead = opts->dead_flags;
+		if ((update_mask & X) && !(dead & 0x10)) {
+			//X gets copied from C so C is still needed
+			dead &= ~1;
+		}
+		for (int8_t flag = FLAG_C; flag >= FLAG_X; --flag)
+		{
+			if (dead & 0x10 >> flag) {
+				update_mask &= ~((X0|X1|X) << (flag*3));
+			}
+		}
+	}
 	for (int8_t flag = FLAG_C; flag >= FLAG_X; --flag)
 	{
 		if (update_mask & X0 << (flag*3)) {
@@ -2372,6 +2385,7 @@ void translate_m68k_stop(m68k_options *opts, m68kinst *inst)
 		//leave supervisor mode
 		swap_ssp_usp(opts);
 	}
+	mov_irdisp(code, 1, opts->gen.context_reg, offsetof(m68k_context, stopped), SZ_B);
 	code_ptr loop_top = code->cur;
 		call(code, opts->do_sync);
 		cmp_irdisp(code, 0, opts->gen.context_reg, offsetof(m68k_context, should_return), SZ_B);
@@ -2391,6 +2405,7 @@ void translate_m68k_stop(m68k_options *opts, m68kinst *inst)
 		*after_cycle_up = code->cur - (after_cycle_up+1);
 		cmp_rdispr(code, opts->gen.context_reg, offsetof(m68k_context, int_cycle), opts->gen.cycles, SZ_D);
 	jcc(code, CC_C, loop_top);
+	mov_irdisp(code, 0, opts->gen.context_reg, offsetof(m68k_context, stopped), SZ_B);
 	//set int pending flag so interrupt fires immediately after stop is done
 	mov_irdisp(code, INT_PENDING_SR_CHANGE, opts->gen.context_reg, offsetof(m68k_context, int_pending), SZ_B);
 }
@@ -2541,6 +2556,7 @@ void m68k_invalidate_code_range(m68k_context *context, uint32_t start, uint32_t
 		//calculate the lowest alias for this address
 		end = mem_chunk->start + ((end - 1 - mem_chunk->start) & mem_chunk->mask) + 1;
 	}
+	m68k_disable_cycle_runs(opts, start, end);
 	uint32_t start_chunk = start / NATIVE_CHUNK_SIZE, end_chunk = end / NATIVE_CHUNK_SIZE;
 	for (uint32_t chunk = start_chunk; chunk <= end_chunk; chunk++)
 	{
@@ -2563,6 +2579,44 @@ void m68k_invalidate_code_range(m68k_context *context, uint32_t start, uint32_t
 	}
 }
 
+//Emits the guard for a run translated by translate_m68k_run. It falls through to the unchecked copy
+//when the cycle count before the last instruction of the run will still be below the limit.
+//*skipped_cycles is the immediate for the cycles of the run up to that point, the branch to the
+//checked copy it returns is pointed at it with m68k_cycle_run_link
+code_ptr m68k_cycle_run_guard(m68k_options *opts, uint32_t **skipped_cycles)
+{
+	code_info *code = &opts->gen.code;
+	mov_ir(code, 0, opts->gen.scratch1, SZ_D);
+	*skipped_cycles = (uint32_t *)(code->cur - sizeof(uint32_t));
+	add_rr(code, opts->gen.cycles, opts->gen.scratch1, SZ_D);
+	cmp_rr(code, opts->gen.scratch1, opts->gen.limit, SZ_D);
+	jcc(code, CC_BE, code->cur + 512);//force 32-bit displacement
+	return code->cur - 6;
+}
+
+//Adds the cycles of the whole run at the end of the unchecked copy and jumps past the checked one
+code_ptr m68k_cycle_run_exit(m68k_options *opts, uint32_t run_cycles)
+{
+	code_info *code = &opts->gen.code;
+	add_ir(code, run_cycles, opts->gen.cycles, SZ_D);
+	jmp(code, code->cur + 512);//force 32-bit displacement
+	return code->cur - 5;
+}
+
+void m68k_cycle_run_link(code_ptr branch, code_ptr target)
+{
+	//jcc rel32 has a 2 byte opcode starting with 0F, jmp rel32 a 1 byte one
+	code_ptr disp = branch + (*branch == 0x0F ? 2 : 1);
+	*((uint32_t *)disp) = target - (disp + 4);
+}
+
+void m68k_cycle_run_disable(code_ptr guard)
+{
+	code_ptr checked = guard + 6 + *((int32_t *)(guard + 2));
+	code_info code = {guard, guard + 6, 0};
+	jmp(&code, checked);
+}
+
 void m68k_breakpoint_patch(m68k_context *context, uint32_t address, debug_handler bp_handler, code_ptr native_addr)
 {
 	m68k_options * opts = context->opts;
@@ -2591,6 +2645,7 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 	memset(opts, 0, sizeof(*opts));
 	opts->gen.memmap = memmap;
 	opts->gen.memmap_chunks = num_chunks;
+	opts->gen.code_flushed = m68k_code_flushed;
 	opts->gen.address_size = SZ_D;
 	opts->gen.address_mask = 0xFFFFFF;
 	opts->gen.byte_swap = 1;
@@ -3173,6 +3228,10 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 	call(code, opts->gen.save_context);
 	call_args_abi(code, (code_ptr)opts->int_ack, 1, opts->gen.context_reg);
 	mov_rr(code, RAX, opts->gen.context_reg, SZ_PTR);
+	//the vector is looked up by address and the return address into translated code is discarded
+	//so this is a point where the translation cache can be thrown away safely
+	call_args_abi(code, (code_ptr)m68k_check_code_flush, 1, opts->gen.context_reg);
+	mov_rr(code, RAX, opts->gen.context_reg, SZ_PTR);
 	call(code, opts->gen.load_context);
 	cycles(&opts->gen, 4); //idle period after int ack
 
@@ -3305,4 +3364,5 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 	code->stack_off = tmp_stack_off;
 
 	retranslate_calc(&opts->gen);
+	set_code_flush_point(&opts->gen);
 }
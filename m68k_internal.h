@@ -38,6 +38,10 @@ void m68k_trap_if_not_supervisor(m68k_options *opts, m68kinst *inst);
 void m68k_breakpoint_patch(m68k_context *context, uint32_t address, debug_handler bp_handler, code_ptr native_addr);
 void m68k_check_cycles_int_latch(m68k_options *opts);
 uint8_t translate_m68k_op(m68kinst * inst, host_ea * ea, m68k_options * opts, uint8_t dst);
+code_ptr m68k_cycle_run_guard(m68k_options *opts, uint32_t **skipped_cycles);
+code_ptr m68k_cycle_run_exit(m68k_options *opts, uint32_t run_cycles);
+void m68k_cycle_run_link(code_ptr branch, code_ptr target);
+void m68k_cycle_run_disable(code_ptr guard);
 
 //functions implemented in m68k_core.c
 int8_t native_reg(m68k_op_info * op, m68k_options * opts);
@@ -52,7 +56,10 @@ void swap_ssp_usp(m68k_options * opts);
 code_ptr get_native_address(m68k_options *opts, uint32_t address);
 code_ptr get_native_address_trans(m68k_context * context, uint32_t address);
 void * m68k_retranslate_inst(uint32_t address, m68k_context * context);
+m68k_context *m68k_check_code_flush(m68k_context *context);
+void m68k_code_flushed(void *vcontext);
 m68k_context *m68k_bp_dispatcher(m68k_context *context, uint32_t address);
+void m68k_disable_cycle_runs(m68k_options *opts, uint32_t start, uint32_t end);
 
 //individual instructions
 void translate_m68k_bcc(m68k_options * opts, m68kinst * inst);
@@ -644,12 +644,12 @@ void view_key_bindings(struct nk_context *context)
 		"gamepads.2.start", "gamepads.2.mode"
 	};
 	static const char *general_binds[] = {
-		"ui.menu", "ui.save_state", "ui.load_state", "ui.toggle_fullscreen", "ui.soft_reset", "ui.reload",
+		"ui.menu", "ui.save_state", "ui.load_state", "ui.rewind", "ui.toggle_fullscreen", "ui.soft_reset", "ui.reload",
 		"ui.screenshot", "ui.vgm_log", "ui.record_video", "ui.sms_pause", "ui.toggle_keyboard_captured", 
 		"ui.release_mouse", "ui.exit", "cassette.play", "cassette.stop", "cassette.rewind"
 	};
 	static const char *general_names[] = {
-		"Show Menu", "Quick Save", "Quick Load", "Toggle Fullscreen", "Soft Reset", "Reload Media",
+		"Show Menu", "Quick Save", "Quick Load", "Rewind", "Toggle Fullscreen", "Soft Reset", "Reload Media",
 		"Internal Screenshot", "Toggle VGM Log", "Toggle Video Recording", "SMS Pause", "Capture Keyboard", 
 		"Release Mouse", "Exit", "Cassette Play", "Cassette Stop", "Cassette Rewind"
 	};
@@ -823,6 +823,7 @@ const char *translate_binding_option(const char *option)
 		conf_names = tern_insert_ptr(conf_names, "ui.toggle_fullscreen", "Toggle Fullscreen");
 		conf_names = tern_insert_ptr(conf_names, "ui.soft_reset", "Soft Reset");
 		conf_names = tern_insert_ptr(conf_names, "ui.reload", "Reload ROM");
+		conf_names = tern_insert_ptr(conf_names, "ui.rewind", "Rewind");
 		conf_names = tern_insert_ptr(conf_names, "ui.sms_pause", "SMS Pause");
 		conf_names = tern_insert_ptr(conf_names, "ui.toggle_keyboard_captured", "Toggle Keyboard Capture");
 		conf_names = tern_insert_ptr(conf_names, "cassette.play", "Cassette Play");
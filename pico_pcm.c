@@ -96,6 +96,8 @@ int16_t upd7755_calc_sample(uint8_t sample, uint8_t *state)
 
 void pico_pcm_run(pico_pcm *pcm, uint32_t cycle)
 {
+	int16_t block[AUDIO_BLOCK_FRAMES];
+	uint32_t block_frames = 0;
 	while (pcm->cycle < cycle)
 	{
 		pcm->cycle += pcm->clock_inc;
@@ -106,7 +108,11 @@ void pico_pcm_run(pico_pcm *pcm, uint32_t cycle)
 			scope_add_sample(pcm->scope, pcm->scope_channel, (pcm->output >> shift) * 32, 0);
 		}
 #endif
-		render_put_mono_sample(pcm->audio, (pcm->output >> shift) * 32);
+		block[block_frames++] = (pcm->output >> shift) * 32;
+		if (block_frames == AUDIO_BLOCK_FRAMES) {
+			render_put_mono_block(pcm->audio, block, block_frames);
+			block_frames = 0;
+		}
 		/*
 		Unclear what this bit is actually supposed to do
 		But some games expect ADPCM to work with it cleared
@@ -173,6 +179,7 @@ void pico_pcm_run(pico_pcm *pcm, uint32_t cycle)
 			}
 		}
 	}
+	render_put_mono_block(pcm->audio, block, block_frames);
 }
 
 // RI??E???FF???VVV
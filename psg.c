@@ -10,6 +10,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+
+static void psg_write_reg(psg_context * context, uint8_t value);
+
 void psg_init(psg_context * context, uint32_t master_clock, uint32_t clock_div)
 {
 	memset(context, 0, sizeof(*context));
@@ -35,11 +38,20 @@ void psg_enable_scope(psg_context *context, oscilloscope *scope, uint32_t master
 	{
 		context->scope_channel[i] = scope_add_channel(scope, names[i], master_clock / context->clock_inc);
 	}
+	if (context->synth) {
+		psg_flush_deferred(context);
+		context->synth->scope = scope;
+		memcpy(context->synth->scope_channel, context->scope_channel, sizeof(context->scope_channel));
+	}
 #endif
 }
 
 void psg_free(psg_context *context)
 {
+	if (context->synth) {
+		free(context->synth);
+		free(context->write_queue);
+	}
 	render_free_source(context->audio);
 	free(context);
 }
@@ -55,6 +67,22 @@ void psg_write(psg_context * context, uint8_t value)
 		vgm_sn76489_write(context->vgm, context->cycles, value);
 	}
 	event_log(EVENT_PSG_REG, context->cycles, sizeof(value), &value);
+	if (context->synth) {
+		if (context->queued_writes == PSG_DEFERRED_WRITES) {
+			//the owner normally flushes all audio sources together once psg_deferred_full
+			//says so, this only catches writes from elsewhere, like the debugger
+			psg_flush_deferred(context);
+		}
+		context->write_queue[context->queued_writes++] = (psg_queued_write){
+			.cycle = context->cycles,
+			.value = value
+		};
+	}
+	psg_write_reg(context, value);
+}
+
+static void psg_write_reg(psg_context * context, uint8_t value)
+{
 	if (value & 0x80) {
 		context->latch = value & 0x70;
 		uint8_t channel = value >> 5 & 0x3;
@@ -105,9 +133,106 @@ static int16_t volume_table[16] = {
 	2067/PSG_VOL_DIV, 1642/PSG_VOL_DIV, 1304/PSG_VOL_DIV, 0
 };
 
+static void psg_shift_noise(psg_context *context)
+{
+	context->noise_out = context->lsfr & 1;
+	context->lsfr = (context->lsfr >> 1) | (context->lsfr << 15);
+	if (context->noise_type) {
+		//white noise
+		if (context->lsfr & 0x4) {
+			context->lsfr ^= 0x8000;
+		}
+	}
+}
+
+static uint8_t psg_audible(psg_context *context, int channel)
+{
+	return context->volume[channel] != 0xF && (context->pan & (0x11 << channel));
+}
+
+//Advances a channel by a number of clocks without rendering anything
+static void psg_skip(psg_context *context, int channel, uint32_t clocks)
+{
+	uint32_t first = context->counters[channel] ? context->counters[channel] : 1;
+	if (clocks < first) {
+		context->counters[channel] -= clocks;
+		return;
+	}
+	uint32_t period = context->counter_load[channel] ? context->counter_load[channel] : 1;
+	uint32_t toggles = 1 + (clocks - first) / period;
+	context->counters[channel] = context->counter_load[channel] - (clocks - first) % period;
+	if (channel != 3) {
+		context->output_state[channel] ^= toggles & 1;
+		return;
+	}
+	//the LFSR shifts on every rising edge so noise needs to visit each one
+	for (; toggles; toggles--)
+	{
+		context->output_state[3] = !context->output_state[3];
+		if (context->output_state[3]) {
+			psg_shift_noise(context);
+		}
+	}
+}
+
+static void psg_mix(psg_context *context, int16_t *left, int16_t *right)
+{
+	int16_t left_accum = 0, right_accum = 0;
+	uint8_t pan_left = 0x10, pan_right = 0x1;
+	for (int i = 0; i < 4; i++) {
+		if (i == 3 ? context->noise_out : context->output_state[i]) {
+			int16_t value = volume_table[context->volume[i]];
+			if (context->pan & pan_left) {
+				left_accum += value;
+			}
+			if (context->pan & pan_right) {
+				right_accum += value;
+			}
+		}
+		pan_left <<= 1;
+		pan_right <<= 1;
+	}
+	*left = left_accum;
+	*right = right_accum;
+}
+
 void psg_run(psg_context * context, uint32_t cycles)
 {
+	if (context->synth) {
+		//sound is generated by the synth context when queued writes are flushed
+		if (context->cycles < cycles) {
+			context->cycles += (cycles - context->cycles + context->clock_inc - 1) / context->clock_inc * context->clock_inc;
+		}
+		return;
+	}
+	int16_t block[AUDIO_BLOCK_FRAMES * 2];
+	uint32_t block_frames = 0;
 	while (context->cycles < cycles) {
+		if (!context->scope) {
+			//output can only change when an audible channel's counter expires
+			//so the clocks before that all produce the same sample
+			uint32_t idle = (cycles - context->cycles + context->clock_inc - 1) / context->clock_inc;
+			for (int i = 0; i < 4; i++) {
+				if (psg_audible(context, i)) {
+					uint32_t to_edge = context->counters[i] ? context->counters[i] - 1 : 0;
+					if (to_edge < idle) {
+						idle = to_edge;
+					}
+				}
+			}
+			if (idle) {
+				render_put_stereo_block(context->audio, block, block_frames);
+				block_frames = 0;
+				for (int i = 0; i < 4; i++) {
+					psg_skip(context, i, idle);
+				}
+				int16_t left, right;
+				psg_mix(context, &left, &right);
+				render_repeat_stereo_sample(context->audio, left, right, idle);
+				context->cycles += idle * context->clock_inc;
+				continue;
+			}
+		}
 		uint8_t trigger[4] = {0,0,0,0};
 		for (int i = 0; i < 4; i++) {
 			if (context->counters[i]) {
@@ -118,14 +243,7 @@ void psg_run(psg_context * context, uint32_t cycles)
 				context->output_state[i] = !context->output_state[i];
 				trigger[i] = context->output_state[i];
 				if (i == 3 && context->output_state[i]) {
-					context->noise_out = context->lsfr & 1;
-					context->lsfr = (context->lsfr >> 1) | (context->lsfr << 15);
-					if (context->noise_type) {
-						//white noise
-						if (context->lsfr & 0x4) {
-							context->lsfr ^= 0x8000;
-						}
-					}
+					psg_shift_noise(context);
 				}
 			}
 		}
@@ -170,10 +288,94 @@ void psg_run(psg_context * context, uint32_t cycles)
 		}
 #endif
 
-		render_put_stereo_sample(context->audio, left_accum, right_accum);
+		block[block_frames * 2] = left_accum;
+		block[block_frames * 2 + 1] = right_accum;
+		if (++block_frames == AUDIO_BLOCK_FRAMES) {
+			render_put_stereo_block(context->audio, block, block_frames);
+			block_frames = 0;
+		}
 
 		context->cycles += context->clock_inc;
 	}
+	render_put_stereo_block(context->audio, block, block_frames);
+}
+
+void psg_adjust_cycles(psg_context *context, uint32_t deduction)
+{
+	if (context->synth) {
+		psg_flush_deferred(context);
+		context->synth->cycles -= deduction;
+	}
+	context->cycles -= deduction;
+}
+
+static void psg_clone_synth(psg_context *context)
+{
+	psg_context *synth = context->synth;
+	*synth = *context;
+	synth->vgm = NULL;
+	synth->synth = NULL;
+	synth->write_queue = NULL;
+	synth->queued_writes = 0;
+	context->queued_writes = 0;
+	context->replayed_writes = 0;
+}
+
+void psg_enable_deferred(psg_context *context, uint8_t enabled)
+{
+	if (enabled && !context->synth) {
+		context->synth = malloc(sizeof(psg_context));
+		context->write_queue = calloc(PSG_DEFERRED_WRITES, sizeof(psg_queued_write));
+		psg_clone_synth(context);
+	} else if (!enabled && context->synth) {
+		psg_flush_deferred(context);
+		free(context->synth);
+		free(context->write_queue);
+		context->synth = NULL;
+		context->write_queue = NULL;
+	}
+}
+
+//Renders the synth up to cycle, replaying the queued register writes that happen before it
+void psg_render_deferred(psg_context *context, uint32_t cycle)
+{
+	psg_context *synth = context->synth;
+	if (!synth) {
+		return;
+	}
+	for (; context->replayed_writes < context->queued_writes; context->replayed_writes++)
+	{
+		psg_queued_write *write = context->write_queue + context->replayed_writes;
+		if (write->cycle > cycle) {
+			break;
+		}
+		psg_run(synth, write->cycle);
+		psg_write_reg(synth, write->value);
+	}
+	psg_run(synth, cycle);
+}
+
+void psg_flush_deferred(psg_context *context)
+{
+	psg_context *synth = context->synth;
+	if (!synth) {
+		return;
+	}
+	psg_render_deferred(context, context->cycles);
+	//counters and noise state only advance in the synth
+	vgm_writer *vgm = context->vgm;
+	psg_queued_write *write_queue = context->write_queue;
+	*context = *synth;
+	context->vgm = vgm;
+	context->synth = synth;
+	context->write_queue = write_queue;
+	context->queued_writes = 0;
+	context->replayed_writes = 0;
+}
+
+uint8_t psg_deferred_full(psg_context *context)
+{
+	return context->synth && context->queued_writes == PSG_DEFERRED_WRITES;
 }
 
 void psg_vgm_log(psg_context *context, uint32_t master_clock, vgm_writer *vgm)
@@ -205,6 +407,7 @@ void psg_vgm_log(psg_context *context, uint32_t master_clock, vgm_writer *vgm)
 
 void psg_serialize(psg_context *context, serialize_buffer *buf)
 {
+	psg_flush_deferred(context);
 	save_int16(buf, context->lsfr);
 	save_buffer16(buf, context->counter_load, 4);
 	save_buffer16(buf, context->counters, 4);
@@ -221,6 +424,7 @@ void psg_serialize(psg_context *context, serialize_buffer *buf)
 void psg_deserialize(deserialize_buffer *buf, void *vcontext)
 {
 	psg_context *context = vcontext;
+	psg_flush_deferred(context);
 	context->lsfr = load_int16(buf);
 	load_buffer16(buf, context->counter_load, 4);
 	load_buffer16(buf, context->counters, 4);
@@ -234,4 +438,7 @@ void psg_deserialize(deserialize_buffer *buf, void *vcontext)
 	context->noise_type = load_int8(buf);
 	context->latch = load_int8(buf);
 	context->cycles = load_int32(buf);
+	if (context->synth) {
+		psg_clone_synth(context);
+	}
 }
@@ -12,7 +12,16 @@
 #include "vgm.h"
 #include "oscilloscope.h"
 
+#define PSG_DEFERRED_WRITES 256
+
 typedef struct {
+	uint32_t cycle;
+	uint8_t  value;
+} psg_queued_write;
+
+typedef struct psg_context psg_context;
+
+struct psg_context {
 	audio_source *audio;
 	vgm_writer   *vgm;
 	oscilloscope *scope;
@@ -29,7 +38,13 @@ typedef struct {
 	uint8_t  noise_type;
 	uint8_t  latch;
 	uint8_t  pan;
-} psg_context;
+	//when sound generation is deferred, writes are queued and rendered in batches by synth
+	psg_context      *synth;
+	psg_queued_write *write_queue;
+	uint32_t         queued_writes;
+	//number of queued writes the synth has already replayed
+	uint32_t         replayed_writes;
+};
 
 
 void psg_init(psg_context * context, uint32_t master_clock, uint32_t clock_div);
@@ -38,6 +53,11 @@ void psg_free(psg_context *context);
 void psg_adjust_master_clock(psg_context * context, uint32_t master_clock);
 void psg_write(psg_context * context, uint8_t value);
 void psg_run(psg_context * context, uint32_t cycles);
+void psg_adjust_cycles(psg_context *context, uint32_t deduction);
+void psg_enable_deferred(psg_context *context, uint8_t enabled);
+void psg_render_deferred(psg_context *context, uint32_t cycle);
+void psg_flush_deferred(psg_context *context);
+uint8_t psg_deferred_full(psg_context *context);
 void psg_vgm_log(psg_context *context, uint32_t master_clock, vgm_writer *vgm);
 void psg_serialize(psg_context *context, serialize_buffer *buf);
 void psg_deserialize(deserialize_buffer *buf, void *vcontext);
@@ -80,6 +80,11 @@ typedef SDL_Thread* render_thread;
 #define FRAMEBUFFER_UI 2
 #define FRAMEBUFFER_USER_START 3
 
+typedef enum {
+	FRAMEBUFFER_32BPP, //pixels are the 32-bit values returned by render_map_color
+	FRAMEBUFFER_16BPP  //pixels are 16-bit, render_map_color returns RGB565
+} framebuffer_format;
+
 typedef enum {
 	VID_NTSC,
 	VID_PAL,
@@ -107,6 +112,8 @@ void render_save_video(char *path);
 uint8_t render_create_window(char *caption, uint32_t width, uint32_t height, window_close_handler close_handler);
 void render_destroy_window(uint8_t which);
 uint32_t *render_get_framebuffer(uint8_t which, int *pitch);
+//pixel format of the buffers returned by render_get_framebuffer, the pitch is always in bytes
+framebuffer_format render_framebuffer_format(uint8_t which);
 void render_framebuffer_updated(uint8_t which, int width);
 //returns the framebuffer index associated with the Window that has focus
 uint8_t render_get_active_framebuffer(void);
@@ -2,6 +2,15 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
 #include "render_audio.h"
 #include "util.h"
 #include "config.h"
@@ -18,6 +27,7 @@ static uint8_t num_inactive_audio_sources;
 
 static float overall_gain_mult, *mix_buf;
 static int sample_size;
+static audio_resampler default_resampler;
 
 static FILE *wav_file;
 void render_end_audio(void)
@@ -101,6 +111,83 @@ static void clamp_f32(float *samples, void *vstream, int sample_count)
 	}
 }
 
+//Adds count interleaved stereo samples to an interleaved stereo mix buffer
+//each sample is scaled as gain * sample / 0x7FFF, in that order, to match the per sample loop exactly
+static void mix_span_stereo(float *dst, int16_t *src, uint32_t count, float gain)
+{
+	uint32_t i = 0;
+#if defined(__AVX2__)
+	__m256 vgain = _mm256_set1_ps(gain);
+	__m256 vscale = _mm256_set1_ps(0x7FFF);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i wide = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)(src + i)));
+		__m256 scaled = _mm256_div_ps(_mm256_mul_ps(vgain, _mm256_cvtepi32_ps(wide)), vscale);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), scaled));
+	}
+#elif defined(__SSE2__)
+	__m128 vgain = _mm_set1_ps(gain);
+	__m128 vscale = _mm_set1_ps(0x7FFF);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i raw = _mm_loadu_si128((__m128i *)(src + i));
+		//sign extend by placing each sample in the top half of a 32-bit lane
+		__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16));
+		__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16));
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_div_ps(_mm_mul_ps(vgain, lo), vscale)));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_div_ps(_mm_mul_ps(vgain, hi), vscale)));
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	//32-bit NEON has no divide so it uses the scalar loop
+	float32x4_t vscale = vdupq_n_f32(0x7FFF);
+	for (; i + 8 <= count; i += 8)
+	{
+		int16x8_t raw = vld1q_s16(src + i);
+		float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(raw)));
+		float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(raw)));
+		vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vdivq_f32(vmulq_n_f32(lo, gain), vscale)));
+		vst1q_f32(dst + i + 4, vaddq_f32(vld1q_f32(dst + i + 4), vdivq_f32(vmulq_n_f32(hi, gain), vscale)));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		dst[i] += gain * ((float)src[i]) / 0x7FFF;
+	}
+}
+
+//Adds count mono samples to both channels of an interleaved stereo mix buffer
+static void mix_span_mono(float *dst, int16_t *src, uint32_t count, float gain)
+{
+	uint32_t i = 0;
+#if defined(__SSE2__)
+	__m128 vgain = _mm_set1_ps(gain);
+	__m128 vscale = _mm_set1_ps(0x7FFF);
+	for (; i + 4 <= count; i += 4, dst += 8)
+	{
+		__m128i raw = _mm_loadl_epi64((__m128i *)(src + i));
+		__m128 samples = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16));
+		samples = _mm_div_ps(_mm_mul_ps(vgain, samples), vscale);
+		_mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_unpacklo_ps(samples, samples)));
+		_mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_unpackhi_ps(samples, samples)));
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	float32x4_t vscale = vdupq_n_f32(0x7FFF);
+	for (; i + 4 <= count; i += 4, dst += 8)
+	{
+		float32x4_t samples = vdivq_f32(vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(src + i))), gain), vscale);
+		float32x4x2_t both = vzipq_f32(samples, samples);
+		vst1q_f32(dst, vaddq_f32(vld1q_f32(dst), both.val[0]));
+		vst1q_f32(dst + 4, vaddq_f32(vld1q_f32(dst + 4), both.val[1]));
+	}
+#endif
+	for (; i < count; i++, dst += 2)
+	{
+		float sample = gain * ((float)src[i]) / 0x7FFF;
+		dst[0] += sample;
+		dst[1] += sample;
+	}
+}
+
 static int32_t mix_f32(audio_source *audio, float *stream, int samples)
 {
 	float *end = stream + samples;
@@ -110,7 +197,28 @@ static int32_t mix_f32(audio_source *audio, float *stream, int samples)
 	float *cur = stream;
 	float gain_mult = audio->gain_mult * overall_gain_mult;
 	size_t first_add = output_channels > 1 ? 1 : 0, second_add = output_channels > 1 ? output_channels - 1 : 1;
-	if (audio->num_channels == 1) {
+	if (output_channels == 2) {
+		//work on contiguous spans of the ring buffer so the inner loops don't need to wrap
+		while (cur < end && i != i_end)
+		{
+			uint32_t span = i_end > i ? i_end - i : audio->mask - i + 1;
+			uint32_t frames = span / audio->num_channels;
+			uint32_t out_frames = (end - cur) / 2;
+			if (frames > out_frames) {
+				frames = out_frames;
+			}
+			if (!frames) {
+				break;
+			}
+			if (audio->num_channels == 1) {
+				mix_span_mono(cur, src + i, frames, gain_mult);
+			} else {
+				mix_span_stereo(cur, src + i, frames * 2, gain_mult);
+			}
+			cur += frames * 2;
+			i = (i + frames * audio->num_channels) & audio->mask;
+		}
+	} else if (audio->num_channels == 1) {
 		while (cur < end && i != i_end)
 		{
 			*cur += gain_mult * ((float)src[i]) / 0x7FFF;
@@ -215,16 +323,26 @@ uint8_t audio_deadlock_hack(void)
 
 #define BUFFER_INC_RES 0x40000000UL
 
+static void sinc_update_ratio(audio_source *src);
+static void set_buffer_inc(audio_source *src, uint64_t inc)
+{
+	src->buffer_inc = inc;
+	src->buffer_inc_recip = inc ? ((1ULL << 48) + inc - 1) / inc : 0;
+	if (src->sinc) {
+		sinc_update_ratio(src);
+	}
+}
+
 void render_audio_adjust_clock(audio_source *src, uint64_t master_clock, uint64_t sample_divider)
 {
-	src->buffer_inc = ((BUFFER_INC_RES * sample_divider * (uint64_t)sample_rate) / master_clock);
+	set_buffer_inc(src, (BUFFER_INC_RES * sample_divider * (uint64_t)sample_rate) / master_clock);
 }
 
 void render_audio_adjust_speed(float adjust_ratio)
 {
 	for (uint8_t i = 0; i < num_audio_sources; i++)
 	{
-		audio_sources[i]->buffer_inc = ((double)audio_sources[i]->buffer_inc) + ((double)audio_sources[i]->buffer_inc) * adjust_ratio + 0.5;
+		set_buffer_inc(audio_sources[i], ((double)audio_sources[i]->buffer_inc) + ((double)audio_sources[i]->buffer_inc) * adjust_ratio + 0.5);
 	}
 }
 
@@ -260,6 +378,7 @@ audio_source *render_audio_source(const char *name, uint64_t master_clock, uint6
 		ret->read_end = render_is_audio_sync() ? buffer_samples * channels : 0;
 		ret->mask = render_is_audio_sync() ? 0xFFFFFFFF : alloc_size-1;
 		ret->gain_mult = 1.0f;
+		render_audio_source_resampler(ret, default_resampler);
 	}
 	render_audio_created(ret);
 
@@ -335,6 +454,7 @@ void render_free_source(audio_source *src)
 		free(src->back);
 		render_free_audio_opaque(src->opaque);
 	}
+	free(src->sinc);
 	free(src);
 }
 
@@ -345,59 +465,314 @@ static int16_t lowpass_sample(audio_source *src, int16_t last, int16_t current)
 	return current;
 }
 
-static void interp_sample(audio_source *src, int16_t last, int16_t current)
+//Returns the weight of the previous input sample for the output sample being generated, 16.16 fixed point
+static uint32_t interp_weight(audio_source *src)
 {
-	int64_t tmp = last * ((src->buffer_fraction << 16) / src->buffer_inc);
-	tmp += current * (0x10000 - ((src->buffer_fraction << 16) / src->buffer_inc));
+	//buffer_fraction never exceeds buffer_inc here so the product fits in 64 bits
+	//only a speed adjustment between samples can push this past 1.0
+	//the reciprocal is rounded up so while buffer_inc is below 2^32 the estimate is exact or one too high
+	uint64_t weight = (src->buffer_fraction * src->buffer_inc_recip) >> 32;
+	if (weight * src->buffer_inc > src->buffer_fraction << 16) {
+		weight--;
+	}
+	return weight;
+}
+
+static void interp_sample(audio_source *src, uint32_t weight, int16_t last, int16_t current)
+{
+	int64_t tmp = last * (int64_t)weight;
+	tmp += current * (0x10000 - (int64_t)weight);
 	src->back[src->buffer_pos++] = tmp >> 16;
 }
 
+//Polyphase windowed-sinc resampler, an alternative to interp_sample
+//Each output sample is a SINC_TAPS point dot product against the most recent input
+//using the filter phase nearest to the output sample's position between inputs
+#define SINC_TAPS 32
+#define SINC_PHASES 256
+#define SINC_COEF_BITS 14
+//passband edge as a fraction of the lower of the input and output Nyquist frequencies
+#define SINC_CUTOFF 0.9
+struct sinc_resampler {
+	//one extra phase so a position of exactly 1.0 doesn't need special casing
+	int16_t  bank[SINC_PHASES + 1][SINC_TAPS];
+	//each input is written twice, SINC_TAPS apart, so the window is always contiguous
+	int16_t  history[2][SINC_TAPS * 2];
+	uint32_t pos;
+	double   ratio;
+};
+
+static void sinc_build(sinc_resampler *sinc, double ratio)
+{
+	double fc = 0.5 * SINC_CUTOFF * (ratio < 1.0 ? ratio : 1.0);
+	double half = SINC_TAPS / 2;
+	for (int phase = 0; phase <= SINC_PHASES; phase++)
+	{
+		//output position between the two newest inputs, counted from the oldest tap
+		//this delays output by SINC_TAPS/2 input samples so both sides of the filter are available
+		double center = half - 1.0 + (double)phase / SINC_PHASES;
+		double coefs[SINC_TAPS], sum = 0;
+		for (int tap = 0; tap < SINC_TAPS; tap++)
+		{
+			double x = tap - center;
+			double sinc = x == 0.0 ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+			double window = fabs(x) >= half ? 0.0 : 0.42 + 0.5 * cos(M_PI * x / half) + 0.08 * cos(2.0 * M_PI * x / half);
+			coefs[tap] = sinc * window;
+			sum += coefs[tap];
+		}
+		for (int tap = 0; tap < SINC_TAPS; tap++)
+		{
+			//normalize each phase for unity gain at DC
+			sinc->bank[phase][tap] = lrint(coefs[tap] / sum * (1 << SINC_COEF_BITS));
+		}
+	}
+	sinc->ratio = ratio;
+}
+
+static void sinc_update_ratio(audio_source *src)
+{
+	double ratio = (double)src->buffer_inc / BUFFER_INC_RES;
+	//speed adjustments from dynamic rate control are tiny, don't rebuild the bank for those
+	if (fabs(ratio - src->sinc->ratio) > src->sinc->ratio * 0.02) {
+		sinc_build(src->sinc, ratio);
+	}
+}
+
+static int16_t sinc_dot(int16_t *coefs, int16_t *window)
+{
+	int32_t sum;
+#if defined(__SSE2__)
+	__m128i acc = _mm_setzero_si128();
+	for (int i = 0; i < SINC_TAPS; i += 8)
+	{
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((__m128i *)(coefs + i)), _mm_loadu_si128((__m128i *)(window + i))));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON)
+	int32x4_t acc = vdupq_n_s32(0);
+	for (int i = 0; i < SINC_TAPS; i += 8)
+	{
+		int16x8_t c = vld1q_s16(coefs + i), w = vld1q_s16(window + i);
+		acc = vmlal_s16(acc, vget_low_s16(c), vget_low_s16(w));
+		acc = vmlal_s16(acc, vget_high_s16(c), vget_high_s16(w));
+	}
+	int32x2_t pair = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	sum = vget_lane_s32(vpadd_s32(pair, pair), 0);
+#else
+	sum = 0;
+	for (int i = 0; i < SINC_TAPS; i++)
+	{
+		sum += coefs[i] * window[i];
+	}
+#endif
+	sum >>= SINC_COEF_BITS;
+	return sum > 0x7FFF ? 0x7FFF : sum < -0x8000 ? -0x8000 : sum;
+}
+
+static void sinc_push(sinc_resampler *sinc, uint8_t channel, int16_t value)
+{
+	sinc->history[channel][sinc->pos] = sinc->history[channel][sinc->pos + SINC_TAPS] = value;
+}
+
+static void sinc_advance(sinc_resampler *sinc)
+{
+	sinc->pos = (sinc->pos + 1) & (SINC_TAPS - 1);
+}
+
+static int16_t *sinc_phase(sinc_resampler *sinc, uint32_t weight)
+{
+	//weight is for the previous input, so the output position is 1.0 - weight
+	if (weight > 0x10000) {
+		weight = 0x10000;
+	}
+	return sinc->bank[((0x10000 - weight) * SINC_PHASES) >> 16];
+}
+
+static void sinc_sample(audio_source *src, int16_t *coefs, uint8_t channel)
+{
+	src->back[src->buffer_pos++] = sinc_dot(coefs, src->sinc->history[channel] + src->sinc->pos);
+}
+
+void render_audio_source_resampler(audio_source *src, audio_resampler type)
+{
+	if (type == RESAMPLER_SINC) {
+		if (!src->sinc) {
+			src->sinc = calloc(1, sizeof(sinc_resampler));
+			sinc_build(src->sinc, (double)src->buffer_inc / BUFFER_INC_RES);
+		}
+	} else {
+		free(src->sinc);
+		src->sinc = NULL;
+	}
+}
+
 static uint32_t sync_samples;
-void render_put_mono_sample(audio_source *src, int16_t value)
+//Used for speculative frames that are never heard
+void render_suppress_source(audio_source *src, uint8_t suppress)
+{
+	src->suppressed = suppress;
+}
+
+//A source that gets more than one sync ahead of the others can have its buffer overwritten
+//before the mixer sees it so chips rendering in batches need to interleave at least this often
+uint32_t render_audio_sync_cycles(uint64_t master_clock)
+{
+	if (!sample_rate) {
+		return 0;
+	}
+	return master_clock * sync_samples / sample_rate;
+}
+
+static uint32_t sync_base(audio_source *src)
+{
+	return render_is_audio_sync() ? 0 : src->read_end;
+}
+
+//base is refreshed whenever the buffer is handed off since the backend may move read_end
+static void check_audio_ready(audio_source *src, uint32_t *base, uint8_t channels)
+{
+	if (((src->buffer_pos - *base) & src->mask)/channels >= sync_samples) {
+		if (render_is_audio_sync()) {
+			//sync threshold can be less than the buffer size, only mix what was written
+			src->read_end = src->buffer_pos;
+		}
+		render_do_audio_ready(src);
+		*base = sync_base(src);
+	}
+	src->buffer_pos &= src->mask;
+}
+
+static void put_mono_sample(audio_source *src, int16_t value, uint32_t *base)
 {
 	value = lowpass_sample(src, src->last_left, value);
+	if (src->sinc) {
+		sinc_push(src->sinc, 0, value);
+		sinc_advance(src->sinc);
+	}
 	src->buffer_fraction += src->buffer_inc;
-	uint32_t base = render_is_audio_sync() ? 0 : src->read_end;
 	while (src->buffer_fraction > BUFFER_INC_RES)
 	{
 		src->buffer_fraction -= BUFFER_INC_RES;
-		interp_sample(src, src->last_left, value);
-
-		if (((src->buffer_pos - base) & src->mask) >= sync_samples) {
-			render_do_audio_ready(src);
+		if (src->sinc) {
+			sinc_sample(src, sinc_phase(src->sinc, interp_weight(src)), 0);
+		} else {
+			interp_sample(src, interp_weight(src), src->last_left, value);
 		}
-		src->buffer_pos &= src->mask;
+		check_audio_ready(src, base, 1);
 	}
 	src->last_left = value;
 }
 
-void render_put_stereo_sample(audio_source *src, int16_t left, int16_t right)
+static void put_stereo_sample(audio_source *src, int16_t left, int16_t right, uint32_t *base)
 {
 	left = lowpass_sample(src, src->last_left, left);
 	right = lowpass_sample(src, src->last_right, right);
+	if (src->sinc) {
+		sinc_push(src->sinc, 0, left);
+		sinc_push(src->sinc, 1, right);
+		sinc_advance(src->sinc);
+	}
 	src->buffer_fraction += src->buffer_inc;
-	uint32_t base = render_is_audio_sync() ? 0 : src->read_end;
 	while (src->buffer_fraction > BUFFER_INC_RES)
 	{
 		src->buffer_fraction -= BUFFER_INC_RES;
 
-		interp_sample(src, src->last_left, left);
-		interp_sample(src, src->last_right, right);
-
-		if (((src->buffer_pos - base) & src->mask)/2 >= sync_samples) {
-			render_do_audio_ready(src);
+		uint32_t weight = interp_weight(src);
+		if (src->sinc) {
+			int16_t *coefs = sinc_phase(src->sinc, weight);
+			sinc_sample(src, coefs, 0);
+			sinc_sample(src, coefs, 1);
+		} else {
+			interp_sample(src, weight, src->last_left, left);
+			interp_sample(src, weight, src->last_right, right);
 		}
-		src->buffer_pos &= src->mask;
+		check_audio_ready(src, base, 2);
 	}
 	src->last_left = left;
 	src->last_right = right;
 }
 
+void render_put_mono_sample(audio_source *src, int16_t value)
+{
+	if (src->suppressed) {
+		return;
+	}
+	uint32_t base = sync_base(src);
+	put_mono_sample(src, value, &base);
+}
+
+void render_put_stereo_sample(audio_source *src, int16_t left, int16_t right)
+{
+	if (src->suppressed) {
+		return;
+	}
+	uint32_t base = sync_base(src);
+	put_stereo_sample(src, left, right, &base);
+}
+
+void render_put_mono_block(audio_source *src, int16_t *samples, uint32_t count)
+{
+	if (src->suppressed) {
+		return;
+	}
+	uint32_t base = sync_base(src);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		put_mono_sample(src, samples[i], &base);
+	}
+}
+
+void render_put_stereo_block(audio_source *src, int16_t *samples, uint32_t count)
+{
+	if (src->suppressed) {
+		return;
+	}
+	uint32_t base = sync_base(src);
+	for (uint32_t i = 0; i < count; i++, samples += 2)
+	{
+		put_stereo_sample(src, samples[0], samples[1], &base);
+	}
+}
+
+void render_repeat_stereo_sample(audio_source *src, int16_t left, int16_t right, uint32_t count)
+{
+	if (src->suppressed) {
+		return;
+	}
+	uint32_t base = sync_base(src);
+	//the filter and resampler need to run for every input until the lowpass output settles
+	while (count && (
+		src->sinc || src->buffer_inc >= BUFFER_INC_RES
+		|| lowpass_sample(src, src->last_left, left) != src->last_left
+		|| lowpass_sample(src, src->last_right, right) != src->last_right
+	)) {
+		put_stereo_sample(src, left, right, &base);
+		count--;
+	}
+	//after that every output sample is the settled value so only the resampler position needs to advance
+	while (count)
+	{
+		uint64_t inputs = (BUFFER_INC_RES - src->buffer_fraction) / src->buffer_inc + 1;
+		if (inputs > count) {
+			src->buffer_fraction += count * src->buffer_inc;
+			break;
+		}
+		count -= inputs;
+		src->buffer_fraction += inputs * src->buffer_inc - BUFFER_INC_RES;
+		src->back[src->buffer_pos++] = src->last_left;
+		src->back[src->buffer_pos++] = src->last_right;
+		check_audio_ready(src, &base, 2);
+	}
+}
+
 static void update_source(audio_source *src, double rc, uint8_t sync_changed)
 {
 	double alpha = src->dt / (src->dt + rc);
 	int32_t lowpass_alpha = (int32_t)(((double)0x10000) * alpha);
 	src->lowpass_alpha = lowpass_alpha;
+	render_audio_source_resampler(src, default_resampler);
 	if (sync_changed) {
 		uint32_t alloc_size = render_is_audio_sync() ? src->num_channels * buffer_samples : nearest_pow2(render_min_buffered() * 4 * src->num_channels);
 		src->back = realloc(src->back, alloc_size * sizeof(int16_t));
@@ -442,9 +817,15 @@ void render_audio_initialized(render_audio_format format, uint32_t rate, uint8_t
 	uint32_t syncs = render_audio_syncs_per_sec();
 	if (syncs) {
 		sync_samples = rate / syncs;
+		if (render_is_audio_sync() && sync_samples > buffer_samples) {
+			//source buffers are only buffer_samples long in the sync to audio path
+			sync_samples = buffer_samples;
+		}
 	} else {
 		sync_samples = buffer_samples;
 	}
+	char * resampler_str = tern_find_path(config, "audio\0resampler\0", TVAL_PTR).ptrval;
+	default_resampler = resampler_str && !strcmp(resampler_str, "sinc") ? RESAMPLER_SINC : RESAMPLER_LINEAR;
 	char * gain_str = tern_find_path(config, "audio\0gain\0", TVAL_PTR).ptrval;
 	overall_gain_mult = db_to_mult(gain_str ? atof(gain_str) : 0.0f);
 	uint8_t sync_changed = old_audio_sync != render_is_audio_sync();
@@ -8,14 +8,23 @@ typedef enum {
 	RENDER_AUDIO_UNKNOWN
 } render_audio_format;
 
+typedef enum {
+	RESAMPLER_LINEAR,
+	RESAMPLER_SINC
+} audio_resampler;
+
+typedef struct sinc_resampler sinc_resampler;
+
 typedef struct {
 	const char *name;
 	void     *opaque;
+	sinc_resampler *sinc; //NULL when using linear interpolation
 	int16_t  *front;
 	int16_t  *back;
 	double   dt;
 	uint64_t buffer_fraction;
 	uint64_t buffer_inc;
+	uint64_t buffer_inc_recip; //2^48 / buffer_inc, avoids a divide per output sample
 	float    gain_mult;
 	uint32_t buffer_pos;
 	uint32_t read_start;
@@ -26,19 +35,32 @@ typedef struct {
 	int16_t  last_right;
 	uint8_t  num_channels;
 	uint8_t  front_populated;
+	uint8_t  suppressed; //samples are dropped before any resampling work is done
 } audio_source;
 
 //public interface
 audio_source *render_audio_source(const char *name, uint64_t master_clock, uint64_t sample_divider, uint8_t channels);
 void render_audio_source_gaindb(audio_source *src, float gain);
+void render_audio_source_resampler(audio_source *src, audio_resampler type);
 void render_audio_adjust_clock(audio_source *src, uint64_t master_clock, uint64_t sample_divider);
 void render_put_mono_sample(audio_source *src, int16_t value);
 void render_put_stereo_sample(audio_source *src, int16_t left, int16_t right);
+//same as calling render_put_mono_sample/render_put_stereo_sample for each sample in order
+//chips collect up to AUDIO_BLOCK_FRAMES samples per call so the filter and resampler run in one loop
+#define AUDIO_BLOCK_FRAMES 128
+//stereo blocks are interleaved left/right, count is in sample frames
+void render_put_mono_block(audio_source *src, int16_t *samples, uint32_t count);
+void render_put_stereo_block(audio_source *src, int16_t *samples, uint32_t count);
+//equivalent to count calls to render_put_stereo_sample with the same values
+void render_repeat_stereo_sample(audio_source *src, int16_t left, int16_t right, uint32_t count);
 void render_pause_source(audio_source *src);
 void render_resume_source(audio_source *src);
+void render_suppress_source(audio_source *src, uint8_t suppress);
 void render_free_source(audio_source *src);
 void render_end_audio(void);
 void render_save_audio(char *path);
+//master clock cycles between audio syncs, for chips that render in batches
+uint32_t render_audio_sync_cycles(uint64_t master_clock);
 //interface for render backends
 void render_audio_initialized(render_audio_format format, uint32_t rate, uint8_t channels, uint32_t buffer_size, int sample_size);
 int mix_and_convert(unsigned char *byte_stream, int len, int *min_remaining_out);
@@ -105,9 +105,12 @@ int render_fullscreen()
 }
 
 uint32_t red_shift, blue_shift, green_shift;
+//bits dropped from each 8-bit channel when the display has narrower fields
+uint32_t red_loss, blue_loss, green_loss;
+static framebuffer_format fb_format;
 uint32_t render_map_color(uint8_t r, uint8_t g, uint8_t b)
 {
-	return r << red_shift | g << green_shift | b << blue_shift;
+	return (r >> red_loss) << red_shift | (g >> green_loss) << green_shift | (b >> blue_loss) << blue_shift;
 }
 
 #ifndef DISABLE_OPENGL
@@ -1086,6 +1089,13 @@ void window_setup(void)
 	blue_shift = varInfo.blue.offset;
 	def.ptrval = "0";
 	max_multiple = atoi(tern_find_path_default(config, "video\0fbdev\0max_multiple\0", def, TVAL_PTR).ptrval);
+	if (max_multiple == 1 && varInfo.bits_per_pixel == 16) {
+		//the VDP renders straight into the display memory so let it produce native 16-bit pixels
+		fb_format = FRAMEBUFFER_16BPP;
+		red_loss = 8 - varInfo.red.length;
+		green_loss = 8 - varInfo.green.length;
+		blue_loss = 8 - varInfo.blue.length;
+	}
 	def.ptrval = "true";
 	copy_use_thread = strcmp(tern_find_path_default(config, "video\0fbdev\0use_thread\0", def, TVAL_PTR).ptrval, "false");
 	if (copy_use_thread) {
@@ -1311,6 +1321,11 @@ void render_destroy_window(uint8_t which)
 	//not supported under fbdev
 }
 
+framebuffer_format render_framebuffer_format(uint8_t which)
+{
+	return which <= FRAMEBUFFER_EVEN ? fb_format : FRAMEBUFFER_32BPP;
+}
+
 static uint8_t last_fb;
 static uint32_t texture_off;
 uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
@@ -1318,7 +1333,7 @@ uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
 	if (max_multiple == 1 && !render_gl) {
 		if (last_fb != which) {
 			*pitch = fb_stride * 2;
-			return framebuffer + (which == FRAMEBUFFER_EVEN ? fb_stride / sizeof(uint32_t) : 0);
+			return (uint32_t *)((uint8_t *)framebuffer + (which == FRAMEBUFFER_EVEN ? fb_stride : 0));
 		}
 		*pitch = fb_stride;
 		return framebuffer;
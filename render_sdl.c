@@ -1982,6 +1982,11 @@ void render_window_refresh(uint8_t window)
 #endif
 }
 
+framebuffer_format render_framebuffer_format(uint8_t which)
+{
+	return FRAMEBUFFER_32BPP;
+}
+
 uint32_t *locked_pixels;
 uint32_t locked_pitch;
 uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <string.h>
+#include "rewind.h"
+#include "util.h"
+
+//Each history entry is a patch that reconstructs the previous snapshot from the one after it.
+//Layout: entry size (32-bit), size of reconstructed snapshot (32-bit), a series of
+//(skip, literal length, literal bytes) tokens and finally the entry size again so the ring
+//can be walked from either end. Skip and length values are stored as LEB128 varints
+#define ENTRY_OVERHEAD (3 * sizeof(uint32_t))
+//minimum run of unchanged bytes that will end a literal run
+#define MIN_SKIP 8
+
+rewind_buffer *rewind_alloc(size_t capacity, uint32_t interval)
+{
+	rewind_buffer *rw = calloc(1, sizeof(rewind_buffer));
+	rw->capacity = capacity;
+	rw->ring = malloc(capacity);
+	rw->interval = interval ? interval : 1;
+	return rw;
+}
+
+void rewind_free(rewind_buffer *rw)
+{
+	if (!rw) {
+		return;
+	}
+	free(rw->ring);
+	free(rw->current);
+	free(rw->spare);
+	free(rw->scratch);
+	free(rw);
+}
+
+void rewind_clear(rewind_buffer *rw)
+{
+	rw->head = rw->tail = rw->used = 0;
+	rw->num_entries = 0;
+	rw->frame_counter = 0;
+	rw->has_current = 0;
+}
+
+uint8_t rewind_frame_done(rewind_buffer *rw)
+{
+	if (++rw->frame_counter >= rw->interval) {
+		rw->frame_counter = 0;
+		return 1;
+	}
+	return 0;
+}
+
+uint32_t rewind_available(rewind_buffer *rw)
+{
+	return rw->num_entries + rw->has_current;
+}
+
+static void ring_write(rewind_buffer *rw, size_t pos, uint8_t *src, size_t len)
+{
+	size_t first = rw->capacity - pos;
+	if (first >= len) {
+		memcpy(rw->ring + pos, src, len);
+	} else {
+		memcpy(rw->ring + pos, src, first);
+		memcpy(rw->ring, src + first, len - first);
+	}
+}
+
+static void ring_read(rewind_buffer *rw, size_t pos, uint8_t *dst, size_t len)
+{
+	size_t first = rw->capacity - pos;
+	if (first >= len) {
+		memcpy(dst, rw->ring + pos, len);
+	} else {
+		memcpy(dst, rw->ring + pos, first);
+		memcpy(dst + first, rw->ring, len - first);
+	}
+}
+
+static uint32_t ring_read32(rewind_buffer *rw, size_t pos)
+{
+	uint32_t val;
+	ring_read(rw, pos, (uint8_t *)&val, sizeof(val));
+	return val;
+}
+
+static void drop_oldest(rewind_buffer *rw)
+{
+	uint32_t size = ring_read32(rw, rw->tail);
+	rw->tail = (rw->tail + size) % rw->capacity;
+	rw->used -= size;
+	rw->num_entries--;
+}
+
+static size_t match_len(uint8_t *a, uint8_t *b, size_t max)
+{
+	size_t len = 0;
+	while (len + sizeof(uint64_t) <= max)
+	{
+		uint64_t wa, wb;
+		memcpy(&wa, a + len, sizeof(wa));
+		memcpy(&wb, b + len, sizeof(wb));
+		if (wa != wb) {
+			break;
+		}
+		len += sizeof(uint64_t);
+	}
+	while (len < max && a[len] == b[len])
+	{
+		len++;
+	}
+	return len;
+}
+
+static size_t diff_len(uint8_t *a, uint8_t *b, size_t max)
+{
+	size_t len = 0;
+	while (len < max)
+	{
+		size_t check = max - len < MIN_SKIP ? max - len : MIN_SKIP;
+		size_t same = 0;
+		while (same < check && a[len + same] == b[len + same])
+		{
+			same++;
+		}
+		if (same == check) {
+			break;
+		}
+		len += same + 1;
+	}
+	return len;
+}
+
+static uint8_t *put_varint(uint8_t *dst, size_t val)
+{
+	while (val >= 0x80)
+	{
+		*(dst++) = val | 0x80;
+		val >>= 7;
+	}
+	*(dst++) = val;
+	return dst;
+}
+
+static uint8_t *get_varint(uint8_t *src, size_t *val)
+{
+	size_t out = 0;
+	uint32_t shift = 0;
+	uint8_t byte;
+	do {
+		byte = *(src++);
+		out |= (size_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	*val = out;
+	return src;
+}
+
+static void reserve_scratch(rewind_buffer *rw, size_t size)
+{
+	if (size > rw->scratch_storage) {
+		rw->scratch_storage = size;
+		rw->scratch = realloc(rw->scratch, size);
+	}
+}
+
+static void reserve_states(rewind_buffer *rw, size_t size)
+{
+	if (size > rw->state_storage) {
+		rw->state_storage = size;
+		rw->current = realloc(rw->current, size);
+		rw->spare = realloc(rw->spare, size);
+	}
+}
+
+//encodes a patch that reconstructs old from new into the scratch buffer
+static uint32_t encode_patch(rewind_buffer *rw, uint8_t *old, size_t old_size, uint8_t *new, size_t new_size)
+{
+	//worst case is alternating single byte skip and literal runs
+	reserve_scratch(rw, old_size * 2 + ENTRY_OVERHEAD + 16);
+	size_t common = old_size < new_size ? old_size : new_size;
+	uint8_t *dst = rw->scratch + 2 * sizeof(uint32_t);
+	size_t pos = 0;
+	while (pos < old_size)
+	{
+		size_t skip = pos < common ? match_len(old + pos, new + pos, common - pos) : 0;
+		pos += skip;
+		size_t literal = pos < common ? diff_len(old + pos, new + pos, common - pos) : old_size - pos;
+		dst = put_varint(dst, skip);
+		dst = put_varint(dst, literal);
+		memcpy(dst, old + pos, literal);
+		dst += literal;
+		pos += literal;
+	}
+	uint32_t size = dst - rw->scratch + sizeof(uint32_t);
+	uint32_t old_size32 = old_size;
+	memcpy(rw->scratch, &size, sizeof(size));
+	memcpy(rw->scratch + sizeof(uint32_t), &old_size32, sizeof(old_size32));
+	memcpy(dst, &size, sizeof(size));
+	return size;
+}
+
+void rewind_push(rewind_buffer *rw, uint8_t *state, size_t size)
+{
+	if (size > 0xFFFFFFFFU / 2) {
+		fatal_error("Rewind snapshots larger than 2GB are not supported");
+	}
+	if (rw->has_current) {
+		uint32_t entry_size = encode_patch(rw, rw->current, rw->current_size, state, size);
+		if (entry_size > rw->capacity) {
+			//history can't hold even a single entry this large, keep only the new snapshot
+			rw->head = rw->tail = rw->used = 0;
+			rw->num_entries = 0;
+		} else {
+			while (rw->capacity - rw->used < entry_size)
+			{
+				drop_oldest(rw);
+			}
+			ring_write(rw, rw->head, rw->scratch, entry_size);
+			rw->head = (rw->head + entry_size) % rw->capacity;
+			rw->used += entry_size;
+			rw->num_entries++;
+		}
+	}
+	reserve_states(rw, size);
+	memcpy(rw->current, state, size);
+	rw->current_size = size;
+	rw->has_current = 1;
+}
+
+uint8_t *rewind_pop(rewind_buffer *rw, size_t *size_out)
+{
+	if (!rw->has_current) {
+		return NULL;
+	}
+	rw->frame_counter = 0;
+	*size_out = rw->current_size;
+	if (!rw->num_entries) {
+		//oldest snapshot stays in place so repeated rewinds stop here
+		return rw->current;
+	}
+	size_t trailer = (rw->head + rw->capacity - sizeof(uint32_t)) % rw->capacity;
+	uint32_t entry_size = ring_read32(rw, trailer);
+	size_t start = (rw->head + rw->capacity - entry_size) % rw->capacity;
+	reserve_scratch(rw, entry_size);
+	ring_read(rw, start, rw->scratch, entry_size);
+	uint32_t old_size;
+	memcpy(&old_size, rw->scratch + sizeof(uint32_t), sizeof(old_size));
+	reserve_states(rw, old_size);
+
+	uint8_t *src = rw->scratch + 2 * sizeof(uint32_t);
+	size_t pos = 0;
+	while (pos < old_size)
+	{
+		size_t skip, literal;
+		src = get_varint(src, &skip);
+		src = get_varint(src, &literal);
+		memcpy(rw->spare + pos, rw->current + pos, skip);
+		pos += skip;
+		memcpy(rw->spare + pos, src, literal);
+		src += literal;
+		pos += literal;
+	}
+	rw->head = start;
+	rw->used -= entry_size;
+	rw->num_entries--;
+
+	//spare now holds the older snapshot, swap so it becomes current
+	uint8_t *ret = rw->current;
+	rw->current = rw->spare;
+	rw->spare = ret;
+	rw->current_size = old_size;
+	return ret;
+}
@@ -0,0 +1,33 @@
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+	uint8_t  *ring;    //delta encoded history, newest entry ends at head
+	uint8_t  *current; //most recent snapshot, stored uncompressed
+	uint8_t  *spare;   //receives the next older snapshot when popping
+	uint8_t  *scratch; //delta encode/decode workspace
+	size_t   capacity;
+	size_t   head;
+	size_t   tail;
+	size_t   used;
+	size_t   current_size;
+	size_t   state_storage;
+	size_t   scratch_storage;
+	uint32_t num_entries;
+	uint32_t interval;
+	uint32_t frame_counter;
+	uint8_t  has_current;
+} rewind_buffer;
+
+rewind_buffer *rewind_alloc(size_t capacity, uint32_t interval);
+void rewind_free(rewind_buffer *rw);
+void rewind_clear(rewind_buffer *rw);
+uint8_t rewind_frame_done(rewind_buffer *rw);
+void rewind_push(rewind_buffer *rw, uint8_t *state, size_t size);
+uint8_t *rewind_pop(rewind_buffer *rw, size_t *size_out);
+uint32_t rewind_available(rewind_buffer *rw);
+
+#endif //REWIND_H_
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "rewind.h"
+
+//Round trip check for the rewind history patch encoding
+//Pushes a series of synthetic snapshots and verifies each one pops back unchanged
+//Usage: rewindtest [-n SNAPSHOTS] [-s SEED]
+
+int headless = 1;
+void render_errorbox(char *title, char *message) {}
+void render_warnbox(char *title, char *message) {}
+void render_infobox(char *title, char *message) {}
+
+#define BASE_SIZE 4096
+
+static uint32_t rng_state;
+static uint32_t rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+//derives the next snapshot from the previous one with a mix of the edits emulated state sees
+static size_t mutate(uint8_t *dst, uint8_t *src, size_t size)
+{
+	size_t new_size = size;
+	switch (rng() % 8)
+	{
+	case 0:
+		//shrink or grow like a VDP FIFO, grown bytes are fresh data
+		new_size = BASE_SIZE - 64 + rng() % 128;
+		break;
+	case 1:
+		//large size change so varints need more than one byte
+		new_size = BASE_SIZE * (1 + rng() % 8);
+		break;
+	}
+	size_t common = size < new_size ? size : new_size;
+	memcpy(dst, src, common);
+	for (size_t i = common; i < new_size; i++)
+	{
+		dst[i] = rng();
+	}
+	uint32_t edits = rng() % 64;
+	for (uint32_t i = 0; i < edits; i++)
+	{
+		size_t pos = rng() % new_size;
+		size_t len = 1 + rng() % (rng() & 1 ? 4 : 300);
+		if (pos + len > new_size) {
+			len = new_size - pos;
+		}
+		for (size_t j = 0; j < len; j++)
+		{
+			dst[pos + j] = rng();
+		}
+	}
+	return new_size;
+}
+
+static int check(uint32_t count, size_t capacity, uint32_t interval)
+{
+	uint8_t **states = calloc(count, sizeof(uint8_t *));
+	size_t *sizes = calloc(count, sizeof(size_t));
+	size_t size = BASE_SIZE;
+	states[0] = malloc(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		states[0][i] = rng() & 3 ? 0 : rng();
+	}
+	sizes[0] = size;
+	for (uint32_t i = 1; i < count; i++)
+	{
+		states[i] = malloc(BASE_SIZE * 8);
+		sizes[i] = mutate(states[i], states[i-1], sizes[i-1]);
+	}
+
+	rewind_buffer *rw = rewind_alloc(capacity, interval);
+	uint32_t newest = 0, failures = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (rewind_frame_done(rw)) {
+			rewind_push(rw, states[i], sizes[i]);
+			newest = i;
+		}
+	}
+	uint32_t available = rewind_available(rw);
+	if (!available || available > count / interval) {
+		printf("capacity %zu: %u entries available after %u pushes\n", capacity, available, count / interval);
+		failures++;
+	}
+	//walk back through every entry still in the history, newest first
+	uint32_t index = newest;
+	for (uint32_t popped = 0; popped < available; popped++, index -= interval)
+	{
+		size_t out_size;
+		uint8_t *out = rewind_pop(rw, &out_size);
+		if (!out) {
+			printf("capacity %zu: pop %u returned nothing\n", capacity, popped);
+			failures++;
+			break;
+		}
+		if (out_size != sizes[index] || memcmp(out, states[index], out_size)) {
+			printf("capacity %zu: snapshot %u does not match after decoding (size %zu, expected %zu)\n", capacity, index, out_size, sizes[index]);
+			failures++;
+		}
+	}
+	rewind_free(rw);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		free(states[i]);
+	}
+	free(states);
+	free(sizes);
+	return failures;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t count = 500;
+	rng_state = 1;
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (!strcmp(argv[i], "-n")) {
+			count = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-s")) {
+			rng_state = atoi(argv[++i]);
+		}
+	}
+	if (count < 2 || !rng_state) {
+		fputs("Usage: rewindtest [-n SNAPSHOTS] [-s SEED]\n", stderr);
+		return 1;
+	}
+	int failures = 0;
+	//large enough to keep everything, small enough that the ring wraps and drops old entries
+	failures += check(count, BASE_SIZE * 16 * count, 1);
+	failures += check(count, BASE_SIZE * 24, 1);
+	failures += check(count, BASE_SIZE * 24 + 13, 3);
+	//history too small for a single entry, only the newest snapshot survives
+	failures += check(count, 16, 1);
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	puts("all snapshots round tripped");
+	return 0;
+}
@@ -70,11 +70,86 @@ static void write_always(rf5c164* pcm)
 	}
 }
 
+//Renders whole sample periods at once, one channel at a time
+//Equivalent to running steps 0-11 of all channels when there is no pending memory write and no scope,
+//since nothing outside of the channel registers and wave RAM can affect the result in that case
+static void render_samples(rf5c164* pcm, int16_t *out, uint32_t frames)
+{
+	int32_t mix[AUDIO_BLOCK_FRAMES * 2];
+	for (uint32_t i = 0; i < frames * 2; i++)
+	{
+		mix[i] = 0;
+	}
+	if (pcm->flags & FLAG_SOUNDING) {
+		for (int i = 0; i < 8; i++)
+		{
+			rf5c164_channel *chan = pcm->channels + i;
+			if (pcm->channel_enable & (1 << i)) {
+				chan->cur_ptr = chan->regs[ST] << 19;
+				continue;
+			}
+			uint32_t inc = (chan->regs[FDH] << 8) | chan->regs[FDL];
+			uint32_t loop = (chan->regs[LSH] << 19) | (chan->regs[LSL] << 11);
+			uint8_t env = chan->regs[ENV], pan_left = chan->regs[PAN] >> 4, pan_right = chan->regs[PAN] & 0xF;
+			for (uint32_t s = 0; s < frames; s++)
+			{
+				if (chan->state == START) {
+					chan->cur_ptr = chan->regs[ST] << 19;
+					chan->state = NORMAL;
+					chan->trigger = 1;
+				} else if (chan->state == LOOP) {
+					chan->trigger = chan->cur_ptr != loop;
+					chan->cur_ptr = loop;
+					chan->state = NORMAL;
+				} else {
+					chan->trigger = 0;
+				}
+				uint8_t byte = pcm->ram[chan->cur_ptr >> 11];
+				if (byte == 0xFF) {
+					chan->state = LOOP;
+				} else {
+					chan->sample = byte;
+				}
+				chan->cur_ptr = (chan->cur_ptr + inc) & 0x7FFFFFF;
+				int16_t sample = chan->sample & 0x7F;
+				if (!(chan->sample & 0x80)) {
+					sample = -sample;
+				}
+				sample *= env;
+				mix[s * 2] += (int16_t)((sample * pan_left) >> 5);
+				mix[s * 2 + 1] += (int16_t)((sample * pan_right) >> 5);
+			}
+		}
+	}
+	for (uint32_t i = 0; i < frames * 2; i++)
+	{
+		out[i] = mix[i] > INT16_MAX ? INT16_MAX : mix[i] < INT16_MIN ? INT16_MIN : mix[i];
+	}
+}
+
 void rf5c164_run(rf5c164* pcm, uint32_t cycle)
 {
 	//TODO: Timing of this is all educated guesses based on documentation, do some real measurements
+	int16_t block[AUDIO_BLOCK_FRAMES * 2];
+	uint32_t block_frames = 0;
 	while (pcm->cycle < cycle)
 	{
+	if (!pcm->step && !pcm->cur_channel && !(pcm->flags & FLAG_PENDING) && !pcm->scope) {
+		uint32_t frames = (cycle - pcm->cycle) / (pcm->clock_step * 96);
+		if (frames) {
+			if (frames > AUDIO_BLOCK_FRAMES - block_frames) {
+				frames = AUDIO_BLOCK_FRAMES - block_frames;
+			}
+			render_samples(pcm, block + block_frames * 2, frames);
+			pcm->cycle += frames * pcm->clock_step * 96;
+			block_frames += frames;
+			if (block_frames == AUDIO_BLOCK_FRAMES) {
+				render_put_stereo_block(pcm->audio, block, block_frames);
+				block_frames = 0;
+			}
+			continue;
+		}
+	}
 	switch (pcm->step)
 	{
 	case 0:
@@ -195,12 +270,18 @@ void rf5c164_run(rf5c164* pcm, uint32_t cycle)
 			} else if (pcm->right < INT16_MIN) {
 				pcm->right = INT16_MIN;
 			}
-			render_put_stereo_sample(pcm->audio, pcm->left, pcm->right);
+			block[block_frames * 2] = pcm->left;
+			block[block_frames * 2 + 1] = pcm->right;
+			if (++block_frames == AUDIO_BLOCK_FRAMES) {
+				render_put_stereo_block(pcm->audio, block, block_frames);
+				block_frames = 0;
+			}
 			pcm->left = pcm->right = 0;
 		}
 		CHECK_LOOP;
 	}
 	}
+	render_put_stereo_block(pcm->audio, block, block_frames);
 }
 
 void rf5c164_write(rf5c164* pcm, uint16_t address, uint8_t value)
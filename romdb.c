@@ -1101,17 +1101,19 @@ rom_info configure_rom(tern_node *rom_db, void *vrom, uint32_t rom_size, void *l
 	if (!entry) {
 		entry = tern_find_node(rom_db, product_id + 3);
 	}
+	rom_info info;
 	if (!entry) {
 		debug_message("Not found in ROM DB, examining header\n\n");
 		if (xband_detect(rom, rom_size)) {
-			return xband_configure_rom(rom_db, rom, rom_size, lock_on, lock_on_size, base_map, base_chunks);
-		}
-		if (realtec_detect(rom, rom_size)) {
-			return realtec_configure_rom(rom, rom_size, base_map, base_chunks);
+			info = xband_configure_rom(rom_db, rom, rom_size, lock_on, lock_on_size, base_map, base_chunks);
+		} else if (realtec_detect(rom, rom_size)) {
+			info = realtec_configure_rom(rom, rom_size, base_map, base_chunks);
+		} else {
+			info = configure_rom_heuristics(rom, rom_size, base_map, base_chunks);
 		}
-		return configure_rom_heuristics(rom, rom_size, base_map, base_chunks);
+		memcpy(info.sha1, raw_hash, sizeof(info.sha1));
+		return info;
 	}
-	rom_info info;
 	info.mapper_type = MAPPER_NONE;
 	info.name = tern_find_ptr(entry, "name");
 	if (info.name) {
@@ -1174,6 +1176,7 @@ rom_info configure_rom(tern_node *rom_db, void *vrom, uint32_t rom_size, void *l
 	handle_io_overrides(entry, &info);
 	info.mouse_mode = tern_find_ptr(entry, "mouse_mode");
 	info.wants_cd = !strcmp(tern_find_ptr_default(entry, "wants_cd", "no"), "yes");
+	memcpy(info.sha1, raw_hash, sizeof(info.sha1));
 
 	return info;
 }
@@ -8,6 +8,8 @@
 #define QUICK_SAVE_SLOT 10
 #define SERIALIZE_SLOT 11
 #define EVENTLOG_SLOT 12
+#define REWIND_SLOT 13
+#define RUNAHEAD_SLOT 14
 
 typedef struct {
 	char   *desc;
@@ -402,6 +402,7 @@ static void *cell_image_write8(uint32_t address, void *vcontext, uint8_t value)
 static void cdd_run(segacd_context *cd, uint32_t cycle)
 {
 	cdd_mcu_run(&cd->cdd, cycle, cd->gate_array + GA_CDD_CTRL, &cd->cdc, &cd->fader);
+	cdd_fader_flush(&cd->fader);
 	lc8951_run(&cd->cdc, cycle);
 }
 
@@ -1697,6 +1698,9 @@ segacd_context *alloc_configure_segacd(system_media *media, uint32_t opts, uint8
 
 void free_segacd(segacd_context *cd)
 {
+	if (cd->cdd.media && cd->cdd.media->type == MEDIA_CDROM) {
+		cdimage_free(cd->cdd.media);
+	}
 	cdd_fader_deinit(&cd->fader);
 	rf5c164_deinit(&cd->pcm);
 	m68k_options_free(cd->m68k->opts);
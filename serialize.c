@@ -15,11 +15,32 @@ void init_serialize(serialize_buffer *buf)
 	buf->size = 0;
 	buf->current_section_start = 0;
 	buf->data = malloc(SERIALIZE_DEFAULT_SIZE);
+	buf->fixed = 0;
 }
 
-static void reserve(serialize_buffer *buf, size_t amount)
+void init_serialize_fixed(serialize_buffer *buf, uint8_t *data, size_t storage)
 {
-	if (amount > (buf->storage - buf->size)) {
+	buf->storage = storage;
+	buf->size = 0;
+	buf->current_section_start = 0;
+	buf->data = data;
+	buf->fixed = 1;
+}
+
+void reset_serialize(serialize_buffer *buf)
+{
+	buf->size = 0;
+	buf->current_section_start = 0;
+}
+
+//returns 0 if there is no room for the requested amount in a fixed buffer
+//size is still advanced by the caller in that case so the required size can be determined
+static uint8_t reserve(serialize_buffer *buf, size_t amount)
+{
+	if (buf->size > buf->storage || amount > (buf->storage - buf->size)) {
+		if (buf->fixed) {
+			return 0;
+		}
 		if (amount < buf->storage) {
 			buf->storage *= 2;
 		} else {
@@ -28,11 +49,15 @@ static void reserve(serialize_buffer *buf, size_t amount)
 		}
 		buf->data = realloc(buf->data, buf->storage + sizeof(*buf));
 	}
+	return 1;
 }
 
 void save_int32(serialize_buffer *buf, uint32_t val)
 {
-	reserve(buf, sizeof(val));
+	if (!reserve(buf, sizeof(val))) {
+		buf->size += sizeof(val);
+		return;
+	}
 	buf->data[buf->size++] = val >> 24;
 	buf->data[buf->size++] = val >> 16;
 	buf->data[buf->size++] = val >> 8;
@@ -41,14 +66,20 @@ void save_int32(serialize_buffer *buf, uint32_t val)
 
 void save_int16(serialize_buffer *buf, uint16_t val)
 {
-	reserve(buf, sizeof(val));
+	if (!reserve(buf, sizeof(val))) {
+		buf->size += sizeof(val);
+		return;
+	}
 	buf->data[buf->size++] = val >> 8;
 	buf->data[buf->size++] = val;
 }
 
 void save_int8(serialize_buffer *buf, uint8_t val)
 {
-	reserve(buf, sizeof(val));
+	if (!reserve(buf, sizeof(val))) {
+		buf->size += sizeof(val);
+		return;
+	}
 	buf->data[buf->size++] = val;
 }
 
@@ -60,14 +91,18 @@ void save_string(serialize_buffer *buf, char *val)
 
 void save_buffer8(serialize_buffer *buf, void *val, size_t len)
 {
-	reserve(buf, len);
-	memcpy(&buf->data[buf->size], val, len);
+	if (reserve(buf, len)) {
+		memcpy(&buf->data[buf->size], val, len);
+	}
 	buf->size += len;
 }
 
 void save_buffer16(serialize_buffer *buf, uint16_t *val, size_t len)
 {
-	reserve(buf, len * sizeof(*val));
+	if (!reserve(buf, len * sizeof(*val))) {
+		buf->size += len * sizeof(*val);
+		return;
+	}
 	for(; len != 0; len--, val++) {
 		buf->data[buf->size++] = *val >> 8;
 		buf->data[buf->size++] = *val;
@@ -76,7 +111,10 @@ void save_buffer16(serialize_buffer *buf, uint16_t *val, size_t len)
 
 void save_buffer32(serialize_buffer *buf, uint32_t *val, size_t len)
 {
-	reserve(buf, len * sizeof(*val));
+	if (!reserve(buf, len * sizeof(*val))) {
+		buf->size += len * sizeof(*val);
+		return;
+	}
 	for(; len != 0; len--, val++) {
 		buf->data[buf->size++] = *val >> 24;
 		buf->data[buf->size++] = *val >> 16;
@@ -101,6 +139,11 @@ void end_section(serialize_buffer *buf)
 	if (section_size > 0xFFFFFFFFU) {
 		fatal_error("Sections larger than 4GB are not supported");
 	}
+	if (buf->current_section_start > buf->storage) {
+		//section header didn't fit in a fixed buffer
+		buf->current_section_start = 0;
+		return;
+	}
 	uint32_t size = section_size;
 	uint8_t *field = buf->data + buf->current_section_start - sizeof(uint32_t);
 	*(field++) = size >> 24;
@@ -9,6 +9,7 @@ typedef struct {
 	size_t  storage;
 	size_t  current_section_start;
 	uint8_t *data;
+	uint8_t fixed; //data is caller provided and is never reallocated
 } serialize_buffer;
 
 typedef struct deserialize_buffer deserialize_buffer;
@@ -55,6 +56,8 @@ enum {
 };
 
 void init_serialize(serialize_buffer *buf);
+void init_serialize_fixed(serialize_buffer *buf, uint8_t *data, size_t storage);
+void reset_serialize(serialize_buffer *buf);
 void save_int32(serialize_buffer *buf, uint32_t val);
 void save_int16(serialize_buffer *buf, uint16_t val);
 void save_int8(serialize_buffer *buf, uint8_t val);
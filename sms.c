@@ -971,9 +971,26 @@ void sms_serialize(sms_context *sms, serialize_buffer *buf)
 	end_section(buf);
 }
 
+static void sync_to_instruction(sms_context *sms)
+{
+	while (!sms->z80->pc) {
+		//advance Z80 to an instruction boundary
+		z80_run(sms->z80, sms->z80->Z80_CYCLE + 1);
+	}
+}
+
 static uint8_t *serialize(system_header *sys, size_t *size_out)
 {
 	sms_context *sms = (sms_context *)sys;
+	if (system_runahead_speculating(sys) && sms->runahead_state.size) {
+		uint8_t *ret = malloc(sms->runahead_state.size);
+		memcpy(ret, sms->runahead_state.data, sms->runahead_state.size);
+		if (size_out) {
+			*size_out = sms->runahead_state.size;
+		}
+		return ret;
+	}
+	sync_to_instruction(sms);
 	serialize_buffer state;
 	init_serialize(&state);
 	sms_serialize(sms, &state);
@@ -983,6 +1000,22 @@ static uint8_t *serialize(system_header *sys, size_t *size_out)
 	return state.data;
 }
 
+static size_t serialize_into(system_header *sys, uint8_t *dst, size_t size)
+{
+	sms_context *sms = (sms_context *)sys;
+	if (system_runahead_speculating(sys) && sms->runahead_state.size) {
+		if (sms->runahead_state.size <= size) {
+			memcpy(dst, sms->runahead_state.data, sms->runahead_state.size);
+		}
+		return sms->runahead_state.size;
+	}
+	sync_to_instruction(sms);
+	serialize_buffer state;
+	init_serialize_fixed(&state, dst, size);
+	sms_serialize(sms, &state);
+	return state.size;
+}
+
 static void ram_deserialize(deserialize_buffer *buf, void *vsms)
 {
 	sms_context *sms = vsms;
@@ -1014,7 +1047,10 @@ static void mapper_deserialize(deserialize_buffer *buf, void *vsms)
 	for (int i = 0; i < sizeof(sms->bank_regs); i++)
 	{
 		sms->bank_regs[i] = load_int8(buf);
-		update_mem_map(i, sms, sms->bank_regs[i]);
+		if (sms->header.info.mapper_type != MAPPER_NONE) {
+			//carts without a mapper have their ROM mapped directly, remapping would invalidate it for nothing
+			update_mem_map(i, sms, sms->bank_regs[i]);
+		}
 	}
 }
 
@@ -1045,6 +1081,8 @@ void sms_deserialize(deserialize_buffer *buf, sms_context *sms)
 static void deserialize(system_header *sys, uint8_t *data, size_t size)
 {
 	sms_context *sms = (sms_context *)sys;
+	system_runahead_cancel(sys);
+	vdp_set_output_suppressed(sms->vdp, 0);
 	deserialize_buffer buffer;
 	init_deserialize(&buffer, data, size);
 	sms_deserialize(&buffer, sms);
@@ -1052,10 +1090,27 @@ static void deserialize(system_header *sys, uint8_t *data, size_t size)
 
 static void save_state(sms_context *sms, uint8_t slot)
 {
-	char *save_path = get_slot_name(&sms->header, slot, "state");
+	if (slot == REWIND_SLOT || slot == RUNAHEAD_SLOT) {
+		//reuse the same buffer for each snapshot to avoid reallocating every frame
+		serialize_buffer *buf = slot == REWIND_SLOT ? &sms->rewind_state : &sms->runahead_state;
+		if (buf->data) {
+			reset_serialize(buf);
+		} else {
+			init_serialize(buf);
+		}
+		sms_serialize(sms, buf);
+		if (slot == REWIND_SLOT) {
+			rewind_push(sms->header.rewind, buf->data, buf->size);
+		} else {
+			vdp_mark_output_position(sms->vdp);
+			system_runahead_saved(&sms->header, buf->data, buf->size);
+		}
+		return;
+	}
 	serialize_buffer state;
 	init_serialize(&state);
 	sms_serialize(sms, &state);
+	char *save_path = get_slot_name(&sms->header, slot, "state");
 	save_to_file(&state, save_path);
 	printf("Saved state to %s\n", save_path);
 	free(save_path);
@@ -1074,9 +1129,56 @@ static uint8_t load_state_path(sms_context *sms, char *path)
 	return ret;
 }
 
+static uint8_t load_rewind_state(sms_context *sms)
+{
+	if (!sms->header.rewind || !rewind_available(sms->header.rewind)) {
+		return 0;
+	}
+#ifndef NEW_CORE
+	if (!sms->z80->native_pc) {
+		sms->header.delayed_load_slot = REWIND_SLOT + 1;
+		return 1;
+	}
+#endif
+	size_t size;
+	uint8_t *data = rewind_pop(sms->header.rewind, &size);
+	deserialize(&sms->header, data, size);
+	//otherwise the older frame counter ends the frame right away and the whole history unwinds at once
+	sms->last_frame = sms->vdp->frame;
+	return 1;
+}
+
+static uint8_t load_runahead_state(sms_context *sms)
+{
+	if (!sms->runahead_state.size) {
+		return 0;
+	}
+#ifndef NEW_CORE
+	if (!sms->z80->native_pc) {
+		sms->header.delayed_load_slot = RUNAHEAD_SLOT + 1;
+		return 1;
+	}
+#endif
+	deserialize_buffer state;
+	init_deserialize(&state, sms->runahead_state.data, sms->runahead_state.size);
+	sms_deserialize(&state, sms);
+	vdp_restore_output_position(sms->vdp);
+	//restored frame counter should not register as a new frame
+	sms->last_frame = sms->vdp->frame;
+	return 1;
+}
+
 static uint8_t load_state(system_header *system, uint8_t slot)
 {
 	sms_context *sms = (sms_context *)system;
+	if (slot == REWIND_SLOT) {
+		return load_rewind_state(sms);
+	}
+	if (slot == RUNAHEAD_SLOT) {
+		return load_runahead_state(sms);
+	}
+	system_runahead_cancel(system);
+	vdp_set_output_suppressed(sms->vdp, 0);
 	char *statepath = get_slot_name(system, slot, "state");
 	uint8_t ret;
 #ifndef NEW_CORE
@@ -1123,13 +1225,24 @@ static void run_sms(system_header *system)
 				}
 			}
 
-			if(exit_after){
-				if (elapsed >= exit_after) {
-					exit(0);
+			if(system->exit_after){
+				if (elapsed >= system->exit_after) {
+					system->exit_after = 0;
+					system->should_exit = 1;
+					system_request_exit(system, 0);
 				} else {
-					exit_after -= elapsed;
+					system->exit_after -= elapsed;
 				}
 			}
+			if (system_rewind_frame(system)) {
+				load_rewind_state(sms);
+				target_cycle = sms->z80->Z80_CYCLE + 3420*16;
+			} else if (system_runahead_frame(system)) {
+				load_runahead_state(sms);
+				//cycle counter went back with the state
+				target_cycle = sms->z80->Z80_CYCLE + 3420*16;
+			}
+			vdp_set_output_suppressed(sms->vdp, system->suppress_video);
 		}
 #ifndef NEW_CORE
 		if ((system->enter_debugger || sms->z80->wp_hit) && sms->z80->pc) {
@@ -1157,20 +1270,17 @@ static void run_sms(system_header *system)
 			target_cycle = sms->z80->Z80_CYCLE + 1;
 		}
 #endif
-		z80_run(sms->z80, target_cycle);
+		PROFILE_RUN(system, PROFILE_Z80, z80_run(sms->z80, target_cycle));
 		if (sms->z80->reset) {
 			z80_clear_reset(sms->z80, sms->z80->Z80_CYCLE + 128*15);
 		}
 		target_cycle = sms->z80->Z80_CYCLE;
-		vdp_run_context(sms->vdp, target_cycle);
-		psg_run(sms->psg, target_cycle);
+		PROFILE_RUN(system, PROFILE_VDP, vdp_run_context(sms->vdp, target_cycle));
+		PROFILE_RUN(system, PROFILE_PSG, psg_run(sms->psg, target_cycle));
 		cassette_run(sms, target_cycle);
 
 		if (system->save_state) {
-			while (!sms->z80->pc) {
-				//advance Z80 to an instruction boundary
-				z80_run(sms->z80, sms->z80->Z80_CYCLE + 1);
-			}
+			sync_to_instruction(sms);
 			save_state(sms, system->save_state - 1);
 			system->save_state = 0;
 		}
@@ -1264,6 +1374,9 @@ static void free_sms(system_header *system)
 	z80_options_free(sms->z80->Z80_OPTS);
 	free(sms->z80);
 	psg_free(sms->psg);
+	system_free_rewind(&sms->header);
+	free(sms->rewind_state.data);
+	free(sms->runahead_state.data);
 	free(sms->i8255);
 	free(sms);
 }
@@ -1282,6 +1395,17 @@ static void request_exit(system_header *system)
 #endif
 }
 
+static void suppress_audio(system_header *system, uint8_t suppress)
+{
+	sms_context *sms = (sms_context *)system;
+	render_suppress_source(sms->psg->audio, suppress);
+}
+
+static void set_rewinding(system_header *system, uint8_t rewinding)
+{
+	system->rewinding = rewinding && system->rewind;
+}
+
 static void inc_debug_mode(system_header *system)
 {
 	sms_context *sms = (sms_context *)system;
@@ -1663,6 +1787,8 @@ sms_context *alloc_configure_sms(system_media *media, system_type stype, uint32_
 	sms->header.free_context = free_sms;
 	sms->header.get_open_bus_value = get_open_bus_value;
 	sms->header.request_exit = request_exit;
+	sms->header.suppress_audio = suppress_audio;
+	sms->header.set_rewinding = set_rewinding;
 	sms->header.soft_reset = soft_reset;
 	sms->header.inc_debug_mode = inc_debug_mode;
 	sms->header.gamepad_down = gamepad_down;
@@ -1676,6 +1802,7 @@ sms_context *alloc_configure_sms(system_media *media, system_type stype, uint32_
 	sms->header.config_updated = config_updated;
 	sms->header.serialize = serialize;
 	sms->header.deserialize = deserialize;
+	sms->header.serialize_into = serialize_into;
 	sms->header.start_vgm_log = start_vgm_log;
 	sms->header.stop_vgm_log = stop_vgm_log;
 	sms->header.toggle_debug_view = toggle_debug_view;
@@ -26,6 +26,8 @@ typedef struct {
 	uint16_t      *keystate;
 	uint8_t       *rom;
 	system_media  *cassette;
+	serialize_buffer rewind_state; //reused between rewind snapshots to avoid reallocating
+	serialize_buffer runahead_state; //state of the real timeline while run-ahead frames are emulated
 	uint32_t      rom_size;
 	uint32_t      master_clock;
 	uint32_t      normal_clock;
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "libretro.h"
+
+//Measures save state snapshot and restore time through the libretro interface
+//Usage: statebench [-f WARMUP_FRAMES] [-n ITERATIONS] ROM [ROM...]
+//Pass one ROM per system type of interest
+
+static bool environment(unsigned cmd, void *data)
+{
+	return 0;
+}
+
+static void video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+}
+
+static void audio_sample(int16_t left, int16_t right)
+{
+}
+
+static size_t audio_sample_batch(const int16_t *data, size_t frames)
+{
+	return frames;
+}
+
+static void input_poll(void)
+{
+}
+
+static int16_t input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static int bench_rom(char *path, uint32_t frames, uint32_t iterations)
+{
+	struct retro_game_info info = {
+		.path = path
+	};
+	if (!retro_load_game(&info)) {
+		fprintf(stderr, "Failed to load %s\n", path);
+		return 0;
+	}
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		retro_run();
+	}
+	size_t size = retro_serialize_size();
+	uint8_t *state = malloc(size);
+	double serialize_time = 0, unserialize_time = 0;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		double start = now();
+		if (!retro_serialize(state, size)) {
+			fprintf(stderr, "Failed to serialize state for %s\n", path);
+			free(state);
+			retro_unload_game();
+			return 0;
+		}
+		double mid = now();
+		retro_unserialize(state, size);
+		unserialize_time += now() - mid;
+		serialize_time += mid - start;
+		//advance a frame so each snapshot sees some changed state
+		retro_run();
+	}
+	printf("%s: %d byte state, snapshot %.2f us, restore %.2f us, total %.2f us\n",
+		path, (int)size, serialize_time * 1000000.0 / iterations, unserialize_time * 1000000.0 / iterations,
+		(serialize_time + unserialize_time) * 1000000.0 / iterations
+	);
+	free(state);
+	retro_unload_game();
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = 60, iterations = 1000;
+	int i;
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Option %s requires an argument\n", argv[i]);
+			return 1;
+		}
+		switch (argv[i][1])
+		{
+		case 'f':
+			frames = atoi(argv[++i]);
+			break;
+		case 'n':
+			iterations = atoi(argv[++i]);
+			break;
+		default:
+			fprintf(stderr, "Unrecognized option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (i >= argc || !iterations) {
+		fputs("Usage: statebench [-f WARMUP_FRAMES] [-n ITERATIONS] ROM [ROM...]\n", stderr);
+		return 1;
+	}
+	retro_set_environment(environment);
+	retro_set_video_refresh(video_refresh);
+	retro_set_audio_sample(audio_sample);
+	retro_set_audio_sample_batch(audio_sample_batch);
+	retro_set_input_poll(input_poll);
+	retro_set_input_state(input_state);
+	retro_init();
+	int ret = 0;
+	for (; i < argc; i++)
+	{
+		if (!bench_rom(argv[i], frames, iterations)) {
+			ret = 1;
+		}
+	}
+	retro_deinit();
+	return ret;
+}
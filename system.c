@@ -9,6 +9,9 @@
 #include "paths.h"
 #include "util.h"
 #include "cdimage.h"
+#include "saves.h"
+#include "blastem.h"
+#include "render_audio.h"
 
 #define SMD_HEADER_SIZE 512
 #define SMD_MAGIC1 0x03
@@ -383,31 +386,44 @@ system_header *alloc_config_system(system_type stype, system_media *media, uint3
 		lock_on = media->chain->buffer;
 		lock_on_size = media->chain->size;
 	}
+	system_header *ret;
 	switch (stype)
 	{
 	case SYSTEM_GENESIS:
-		return &(alloc_config_genesis(media->buffer, media->size, lock_on, lock_on_size, opts, force_region))->header;
+		ret = &(alloc_config_genesis(media->buffer, media->size, lock_on, lock_on_size, opts, force_region))->header;
+		break;
 	case SYSTEM_GENESIS_PLAYER:
-		return &(alloc_config_gen_player(media->buffer, media->size))->header;
+		ret = &(alloc_config_gen_player(media->buffer, media->size))->header;
+		break;
 	case SYSTEM_SEGACD:
-		return &(alloc_config_genesis_cdboot(media, opts, force_region))->header;
+		ret = &(alloc_config_genesis_cdboot(media, opts, force_region))->header;
+		break;
 #ifndef NO_Z80
 	case SYSTEM_SMS:
 	case SYSTEM_GAME_GEAR:
 	case SYSTEM_SG1000:
 	case SYSTEM_SC3000:
-		return &(alloc_configure_sms(media, stype, opts, force_region))->header;
+		ret = &(alloc_configure_sms(media, stype, opts, force_region))->header;
+		break;
 	case SYSTEM_COLECOVISION:
-		return &(alloc_configure_coleco(media))->header;
+		ret = &(alloc_configure_coleco(media))->header;
+		break;
 #endif
 	case SYSTEM_MEDIA_PLAYER:
-		return &(alloc_media_player(media, opts))->header;
+		ret = &(alloc_media_player(media, opts))->header;
+		break;
 	case SYSTEM_PICO:
 	case SYSTEM_COPERA:
-		return &(alloc_config_pico(media->buffer, media->size, lock_on, lock_on_size, opts, force_region, stype))->header;
+		ret = &(alloc_config_pico(media->buffer, media->size, lock_on, lock_on_size, opts, force_region, stype))->header;
+		break;
 	default:
 		return NULL;
 	}
+	if (ret) {
+		//command line frame limit is copied so each instance counts down independently
+		ret->exit_after = exit_after;
+	}
+	return ret;
 }
 
 system_header *alloc_config_player(system_type stype, event_reader *reader)
@@ -426,6 +442,174 @@ void system_request_exit(system_header *system, uint8_t force_release)
 	system->request_exit(system);
 }
 
+//Serializes into a caller provided buffer, falling back to a copy of an allocated state
+//for systems that don't implement serialize_into. Returns 0 if saving is not supported
+size_t system_serialize_into(system_header *system, uint8_t *dst, size_t size)
+{
+	if (system->serialize_into) {
+		return system->serialize_into(system, dst, size);
+	}
+	if (!system->serialize) {
+		return 0;
+	}
+	size_t state_size;
+	uint8_t *state = system->serialize(system, &state_size);
+	if (!state) {
+		return 0;
+	}
+	if (dst && state_size <= size) {
+		memcpy(dst, state, state_size);
+	}
+	free(state);
+	return state_size;
+}
+
+#define DEFAULT_REWIND_MEMORY 8 //in MB
+void system_init_rewind(system_header *system)
+{
+	system_free_rewind(system);
+	if (!system->serialize || !system->load_state) {
+		return;
+	}
+	char *enabled = tern_find_path_default(config, "system\0rewind\0", (tern_val){.ptrval = "off"}, TVAL_PTR).ptrval;
+	if (strcmp(enabled, "on")) {
+		return;
+	}
+	char *memory = tern_find_path(config, "system\0rewind_memory\0", TVAL_PTR).ptrval;
+	char *interval = tern_find_path(config, "system\0rewind_interval\0", TVAL_PTR).ptrval;
+	size_t megabytes = memory ? atoi(memory) : DEFAULT_REWIND_MEMORY;
+	if (!megabytes) {
+		megabytes = DEFAULT_REWIND_MEMORY;
+	}
+	system->rewind = rewind_alloc(megabytes * 1024 * 1024, interval ? atoi(interval) : 1);
+}
+
+void system_free_rewind(system_header *system)
+{
+	rewind_free(system->rewind);
+	system->rewind = NULL;
+	system->rewinding = 0;
+}
+
+//Called by system implementations when a frame completes
+//Returns 1 if the caller should load REWIND_SLOT, otherwise queues a rewind snapshot when one is due
+uint8_t system_rewind_frame(system_header *system)
+{
+	if (!system->rewind || system->runahead_pending) {
+		//speculative run-ahead frames are not part of the history
+		return 0;
+	}
+	if (system->rewinding) {
+		return rewind_available(system->rewind) != 0;
+	}
+	if (rewind_frame_done(system->rewind)) {
+		if (system->runahead_frames) {
+			system->rewind_capture = 1;
+		} else if (!system->save_state) {
+			system->save_state = REWIND_SLOT + 1;
+		}
+	}
+	return 0;
+}
+
+//Starts or stops stepping back through the rewind history, rewinding starts at the next frame boundary
+void system_set_rewinding(system_header *system, uint8_t rewinding)
+{
+	if (system->set_rewinding) {
+		system->set_rewinding(system, rewinding);
+	}
+}
+
+static void suppress_audio(system_header *system, uint8_t suppress)
+{
+	if (system->suppress_audio) {
+		system->suppress_audio(system, suppress);
+	}
+}
+
+#define MAX_RUNAHEAD_FRAMES 6
+void system_init_runahead(system_header *system)
+{
+	system->runahead_frames = 0;
+	system_runahead_cancel(system);
+	if (!system->serialize_into || !system->load_state) {
+		return;
+	}
+	char *frames = tern_find_path(config, "system\0runahead\0", TVAL_PTR).ptrval;
+	if (frames) {
+		int num = atoi(frames);
+		system->runahead_frames = num < 0 ? 0 : num > MAX_RUNAHEAD_FRAMES ? MAX_RUNAHEAD_FRAMES : num;
+	}
+}
+
+//Abandons any speculative frames in progress, used when the state is replaced from outside
+void system_runahead_cancel(system_header *system)
+{
+	if (system->delayed_load_slot == RUNAHEAD_SLOT + 1) {
+		system->delayed_load_slot = 0;
+	}
+	if (system->save_state == RUNAHEAD_SLOT + 1) {
+		system->save_state = 0;
+	}
+	system->runahead_pending = 0;
+	system->suppress_video = 0;
+	suppress_audio(system, 0);
+}
+
+//Called by system implementations when a frame completes, after system_rewind_frame
+//The real frame is emulated with video suppressed and saved to RUNAHEAD_SLOT, then runahead_frames
+//speculative frames are run with audio suppressed and only the last one is shown
+//Returns 1 if the caller should load RUNAHEAD_SLOT to return to the real timeline
+uint8_t system_runahead_frame(system_header *system)
+{
+	if (!system->runahead_frames) {
+		return 0;
+	}
+	if (system->delayed_load_slot && system->delayed_load_slot != RUNAHEAD_SLOT + 1) {
+		//a state load is pending and will replace whatever we were speculating on
+		system_runahead_cancel(system);
+		return 0;
+	}
+	if (system->runahead_pending) {
+		if (--system->runahead_pending) {
+			system->suppress_video = system->runahead_pending > 1;
+			return 0;
+		}
+		//the frame that was just shown is the last speculative one
+		system->suppress_video = 1;
+		suppress_audio(system, 0);
+		return 1;
+	}
+	if (system->rewinding || system->save_state) {
+		//let the pending save or rewind happen on the real timeline first
+		system->suppress_video = 0;
+		suppress_audio(system, 0);
+		return 0;
+	}
+	system->save_state = RUNAHEAD_SLOT + 1;
+	system->runahead_pending = system->runahead_frames;
+	system->suppress_video = system->runahead_frames > 1;
+	return 0;
+}
+
+//Returns 1 when the emulated state is ahead of the real timeline and the run-ahead snapshot
+//should be used instead for anything that needs the real state
+uint8_t system_runahead_speculating(system_header *system)
+{
+	return system->runahead_pending || system->delayed_load_slot == RUNAHEAD_SLOT + 1;
+}
+
+//Called by system implementations after saving RUNAHEAD_SLOT
+void system_runahead_saved(system_header *system, uint8_t *data, size_t size)
+{
+	//audio produced before this point is part of the real timeline and won't be replayed
+	suppress_audio(system, 1);
+	if (system->rewind_capture) {
+		system->rewind_capture = 0;
+		rewind_push(system->rewind, data, size);
+	}
+}
+
 void* load_media_subfile(const system_media *media, char *path, uint32_t *sizeout)
 {
 #ifdef IS_LIB
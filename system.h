@@ -48,6 +48,33 @@ enum {
 	CASSETTE_REWIND
 };
 
+enum {
+	PROFILE_Z80,
+	PROFILE_VDP,
+	PROFILE_YM,
+	PROFILE_PSG,
+	PROFILE_CD,
+	NUM_PROFILE_COMPONENTS
+};
+
+//Wall clock time spent in each component while a profile is attached to a system
+//Only calls made from the main sync loop are counted, anything else (including the
+//main CPU itself) is left to the caller to derive from the total run time
+typedef struct {
+	uint64_t ns[NUM_PROFILE_COMPONENTS];
+} system_profile;
+
+#define PROFILE_RUN(system, component, call) \
+	do { \
+		if ((system)->profile) { \
+			uint64_t profile_start = get_monotonic_ns(); \
+			call; \
+			(system)->profile->ns[component] += get_monotonic_ns() - profile_start; \
+		} else { \
+			call; \
+		} \
+	} while (0)
+
 typedef enum {
 	MEDIA_CART,
 	MEDIA_CDROM
@@ -67,6 +94,8 @@ enum {
 typedef struct {
 	FILE       *f;
 	flac_file  *flac;
+	uint8_t    *mapped; //contents of f when it could be memory mapped
+	size_t     mapped_size;
 	uint32_t   file_offset;
 	uint32_t   fake_pregap;
 	uint32_t   pregap_lba;
@@ -78,6 +107,8 @@ typedef struct {
 	track_type type;
 } track_info;
 
+typedef struct cd_sector_cache cd_sector_cache;
+
 typedef uint8_t (*seek_fun)(system_media *media, uint32_t sector);
 typedef uint8_t (*read_fun)(system_media *media, uint32_t offset);
 
@@ -90,6 +121,7 @@ struct system_media {
 	system_media *chain;
 	track_info   *tracks;
 	uint8_t      *tmp_buffer;
+	cd_sector_cache *sector_cache;
 	zip_file     *zip;
 	seek_fun     seek;
 	read_fun     read;
@@ -98,6 +130,7 @@ struct system_media {
 	uint32_t     cur_track;
 	uint32_t     size;
 	uint32_t     cur_sector;
+	uint32_t     read_pos; //byte position of the next read in the current track's file or decoded FLAC stream
 	uint16_t     cdrom_scramble_lsfr;
 	media_type   type;
 	uint8_t      in_fake_pregap;
@@ -116,10 +149,12 @@ typedef void (*system_mabs_fun)(system_header *, uint8_t, uint16_t, uint16_t);
 typedef void (*system_mrel_fun)(system_header *, uint8_t, int32_t, int32_t);
 typedef uint8_t *(*system_ptrszt_fun_rptr8)(system_header *, size_t *);
 typedef void (*system_ptr8_sizet_fun)(system_header *, uint8_t *, size_t);
+typedef size_t (*system_ptr8_sizet_fun_rsizet)(system_header *, uint8_t *, size_t);
 typedef void (*system_media_fun)(system_header *, system_media *);
 
 #include "arena.h"
 #include "romdb.h"
+#include "rewind.h"
 typedef struct event_reader event_reader;
 
 struct system_header {
@@ -130,6 +165,8 @@ struct system_header {
 	system_fun        persist_save;
 	system_u8_fun_r8  load_state;
 	system_fun        request_exit;
+	system_u8_fun     suppress_audio;
+	system_u8_fun     set_rewinding;
 	system_fun        soft_reset;
 	system_fun        free_context;
 	system_fun_r16    get_open_bus_value;
@@ -146,6 +183,9 @@ struct system_header {
 	system_fun        config_updated;
 	system_ptrszt_fun_rptr8 serialize;
 	system_ptr8_sizet_fun   deserialize;
+	//serializes into a caller provided buffer without allocating, returns the size of the state
+	//if the return value is larger than the buffer, the buffer contents are incomplete
+	system_ptr8_sizet_fun_rsizet serialize_into;
 	system_str_fun          start_vgm_log;
 	system_fun              stop_vgm_log;
 	system_u8_fun           toggle_debug_view;
@@ -153,11 +193,14 @@ struct system_header {
 	system_media_fun        lockon_change;
 	rom_info          info;
 	arena             *arena;
+	rewind_buffer     *rewind;
+	system_profile    *profile; //per-component time accounting, NULL when disabled
 	char              *next_rom;
 	char              *save_dir;
 	char              *paste_buffer;
 	uint32_t          paste_cur_char;
 	int               enter_debugger_frames;
+	int               exit_after; //frames left before exiting, 0 to run indefinitely
 	uint8_t           enter_debugger;
 	uint8_t           should_exit;
 	uint8_t           save_state;
@@ -165,6 +208,11 @@ struct system_header {
 	uint8_t           has_keyboard;
 	uint8_t                 vgm_logging;
 	uint8_t                 force_release;
+	uint8_t                 rewinding;
+	uint8_t                 rewind_capture;   //rewind snapshot is due and will be taken from the next run-ahead save
+	uint8_t                 runahead_frames;  //number of frames to run ahead of the real input, 0 when disabled
+	uint8_t                 runahead_pending; //speculative frames left before returning to the real timeline
+	uint8_t                 suppress_video;   //the next frame should not be presented
 	debugger_type     debugger_type;
 	system_type       type;
 };
@@ -175,6 +223,16 @@ system_type detect_system_type(system_media *media);
 system_header *alloc_config_system(system_type stype, system_media *media, uint32_t opts, uint8_t force_region);
 system_header *alloc_config_player(system_type stype, event_reader *reader);
 void system_request_exit(system_header *system, uint8_t force_release);
+size_t system_serialize_into(system_header *system, uint8_t *dst, size_t size);
+void system_init_rewind(system_header *system);
+void system_free_rewind(system_header *system);
+uint8_t system_rewind_frame(system_header *system);
+void system_set_rewinding(system_header *system, uint8_t rewinding);
+void system_init_runahead(system_header *system);
+void system_runahead_cancel(system_header *system);
+uint8_t system_runahead_frame(system_header *system);
+uint8_t system_runahead_speculating(system_header *system);
+void system_runahead_saved(system_header *system, uint8_t *data, size_t size);
 uint32_t load_media(char * filename, system_media *dst, system_type *stype);
 void* load_media_subfile(const system_media *media, char *path, uint32_t *sizeout);
 
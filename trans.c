@@ -10,6 +10,7 @@
 #include "m68k_core.h"
 #endif
 #include "mem.h"
+#include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +24,19 @@ void render_infobox(char * title, char * buf)
 {
 }
 
+//benchmark mode runs for a fixed number of cycles and reports how fast the 68K core executed them
+#define BENCH_SLICE 1000000
+static uint64_t bench_cycles, bench_done, bench_start;
+
+static void bench_report(m68k_context *context)
+{
+	uint64_t total = bench_done + context->cycles;
+	double seconds = (get_monotonic_ns() - bench_start) / 1000000000.0;
+	printf("%llu cycles in %.3f s, %.2f MHz\n", (unsigned long long)total, seconds, seconds > 0 ? total / seconds / 1000000.0 : 0.0);
+	cpu_options *gen = &context->opts->gen;
+	printf("code cache: %u KB translated, %u KB dead, %u flushes\n", gen->translated_bytes / 1024, gen->dead_bytes / 1024, gen->code_generation);
+}
+
 m68k_context *int_ack(m68k_context *context)
 {
 	return context;
@@ -31,7 +45,16 @@ m68k_context *int_ack(m68k_context *context)
 m68k_context * sync_components(m68k_context * context, uint32_t address)
 {
 #ifndef NEW_CORE
-	if (context->cycles >= context->target_cycle) {
+	if (bench_cycles && context->cycles >= context->target_cycle) {
+		//keep the cycle counter small so long runs don't overflow it
+		bench_done += context->cycles;
+		context->cycles = 0;
+		if (bench_done >= bench_cycles) {
+			bench_report(context);
+			exit(0);
+		}
+		context->target_cycle = context->sync_cycle = BENCH_SLICE;
+	} else if (context->cycles >= context->target_cycle) {
 		puts("hit cycle limit");
 		exit(0);
 	}
@@ -44,6 +67,10 @@ m68k_context * sync_components(m68k_context * context, uint32_t address)
 
 m68k_context *reset_handler(m68k_context *context)
 {
+	if (bench_cycles) {
+		bench_report(context);
+		exit(0);
+	}
 	m68k_print_regs(context);
 	printf("cycles: %d\n", context->cycles);
 	exit(0);
@@ -58,7 +85,17 @@ int main(int argc, char ** argv)
 	char disbuf[1024];
 	unsigned short * cur;
 	m68k_options opts;
-	FILE * f = fopen(argv[1], "rb");
+	int i = 1;
+	if (argc >= 3 && !strcmp(argv[1], "-b")) {
+		//Usage: trans -b CYCLES FILE
+		bench_cycles = strtoull(argv[2], NULL, 10);
+		i = 3;
+	}
+	if (i >= argc) {
+		fputs("Usage: trans [-b CYCLES] FILE\n", stderr);
+		return 1;
+	}
+	FILE * f = fopen(argv[i], "rb");
 	fseek(f, 0, SEEK_END);
 	filesize = ftell(f);
 	fseek(f, 0, SEEK_SET);
@@ -91,10 +128,21 @@ int main(int argc, char ** argv)
 	context->cycles = 20;
 #else
 	context->cycles = 40;
-	context->target_cycle = context->sync_cycle = 8000;
+	context->target_cycle = context->sync_cycle = bench_cycles ? BENCH_SLICE : 8000;
 #endif
+	bench_start = get_monotonic_ns();
 	m68k_reset(context);
 #ifdef NEW_CORE
+	while (bench_cycles && bench_done < bench_cycles)
+	{
+		m68k_execute(context, context->cycles + BENCH_SLICE);
+		bench_done += context->cycles;
+		context->cycles = 0;
+	}
+	if (bench_cycles) {
+		bench_report(context);
+		return 0;
+	}
 	m68k_execute(context, 8000);
 	puts("hit cycle limit");
 #endif
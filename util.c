@@ -684,6 +684,17 @@ time_t get_modification_time(char *path)
 	return (time_t)wintime;
 }
 
+uint64_t get_monotonic_ns(void)
+{
+	static LARGE_INTEGER freq;
+	if (!freq.QuadPart) {
+		QueryPerformanceFrequency(&freq);
+	}
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart / freq.QuadPart * 1000000000ULL + count.QuadPart % freq.QuadPart * 1000000000ULL / freq.QuadPart;
+}
+
 int ensure_dir_exists(const char *path)
 {
 	if (CreateDirectory(path, NULL)) {
@@ -757,6 +768,35 @@ int socket_error_is_wouldblock(void)
 	return WSAGetLastError() == WSAEWOULDBLOCK;
 }
 
+#include <io.h>
+void *map_file(FILE *f, size_t *size)
+{
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(f));
+	if (file == INVALID_HANDLE_VALUE || GetFileType(file) != FILE_TYPE_DISK) {
+		return NULL;
+	}
+	LARGE_INTEGER fsize;
+	if (!GetFileSizeEx(file, &fsize) || !fsize.QuadPart || (uint64_t)fsize.QuadPart > SIZE_MAX) {
+		return NULL;
+	}
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		return NULL;
+	}
+	void *ret = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	//the view keeps the mapping alive
+	CloseHandle(mapping);
+	if (ret) {
+		*size = fsize.QuadPart;
+	}
+	return ret;
+}
+
+void unmap_file(void *ptr, size_t size)
+{
+	UnmapViewOfFile(ptr);
+}
+
 #else
 #include <fcntl.h>
 #include <signal.h>
@@ -960,6 +1000,13 @@ time_t get_modification_time(char *path)
 #endif
 }
 
+uint64_t get_monotonic_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 int ensure_dir_exists(const char *path)
 {
 	struct stat st;
@@ -986,6 +1033,27 @@ int ensure_dir_exists(const char *path)
 	return S_ISDIR(st.st_mode);
 }
 
+#include <sys/mman.h>
+void *map_file(FILE *f, size_t *size)
+{
+	struct stat st;
+	int fd = fileno(f);
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || !st.st_size) {
+		return NULL;
+	}
+	void *ret = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ret == MAP_FAILED) {
+		return NULL;
+	}
+	*size = st.st_size;
+	return ret;
+}
+
+void unmap_file(void *ptr, size_t size)
+{
+	munmap(ptr, size);
+}
+
 #endif
 
 void free_dir_list(dir_entry *list, size_t numentries)
@@ -30,6 +30,10 @@ char *replace_vars(char *base, tern_node *vars, uint8_t allow_env);
 void byteswap_rom(int filesize, uint16_t *cart);
 //Returns the size of a file using fseek and ftell
 long file_size(FILE * f);
+//Maps the whole of a regular file read-only, returns NULL if f is not a regular file or mapping fails
+void *map_file(FILE *f, size_t *size);
+//Releases a mapping returned by map_file
+void unmap_file(void *ptr, size_t size);
 //Strips whitespace and non-printable characters from the beginning and end of a string
 char * strip_ws(char * text);
 //Inserts a null after the first word, returns a pointer to the second word
@@ -78,6 +82,8 @@ void free_dir_list(dir_entry *list, size_t numentries);
 void sort_dir_list(dir_entry *list, size_t num_entries);
 //Gets the modification time of a file
 time_t get_modification_time(char *path);
+//Returns a monotonic timestamp in nanoseconds for measuring elapsed time
+uint64_t get_monotonic_ns(void);
 //Recusrively creates a directory if it does not exist
 int ensure_dir_exists(const char *path);
 //Returns the contents of a symlink in a newly allocated string
@@ -11,6 +11,12 @@
 #include "util.h"
 #include "event_log.h"
 #include "terminal.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
 
 #define NTSC_INACTIVE_START 224
 #define PAL_INACTIVE_START 240
@@ -54,6 +60,10 @@
 #define BORDER_BOT_V28_PAL 32
 #define BORDER_BOT_V30_PAL 24
 
+//With a pipeline attached the replica produces the visible output, so the emulated VDP can skip
+//compositing unless a debug view needs it
+#define SKIP_PIXELS(context) ((context)->replica && !(context)->enabled_debuggers)
+
 enum {
 	INACTIVE = 0,
 	PREPARING, //used for line 0x1FF
@@ -156,15 +166,53 @@ static void update_video_params(vdp_context *context)
 
 static uint8_t static_table_init_done;
 
+//When the framebuffer isn't 32bpp, each line is rendered into line_stage and converted once
+//the VDP moves on so none of the pixel pipeline needs to care about the host format
+static void stage_output(vdp_context *context)
+{
+	if (context->fb_format != FRAMEBUFFER_32BPP && context->output && !context->replica) {
+		context->fb_line = (uint8_t *)context->output;
+		context->output = context->line_stage;
+	}
+}
+
+static void flush_output_line(vdp_context *context)
+{
+	if (!context->fb_line) {
+		return;
+	}
+	uint16_t *dst = (uint16_t *)context->fb_line;
+	for (int i = 0; i < LINEBUF_SIZE; i++)
+	{
+		dst[i] = context->line_stage[i];
+	}
+	context->fb_line = NULL;
+}
+
+//Used when a different context drew the start of the current line
+static void load_staged_output(vdp_context *context)
+{
+	if (!context->fb_line) {
+		return;
+	}
+	uint16_t *src = (uint16_t *)context->fb_line;
+	for (int i = 0; i < LINEBUF_SIZE; i++)
+	{
+		context->line_stage[i] = src[i];
+	}
+}
+
 vdp_context *init_vdp_context(uint8_t region_pal, uint8_t has_max_vsram, uint8_t type)
 {
 	vdp_context *context = calloc(1, sizeof(vdp_context) + VRAM_SIZE);
+	vdp_invalidate_tile_cache(context);
 	if (headless) {
 		context->fb = malloc(512 * LINEBUF_SIZE * sizeof(uint32_t));
 		context->output_pitch = LINEBUF_SIZE * sizeof(uint32_t);
 	} else {
 		context->cur_buffer = FRAMEBUFFER_ODD;
 		context->fb = render_get_framebuffer(FRAMEBUFFER_ODD, &context->output_pitch);
+		context->fb_format = render_framebuffer_format(FRAMEBUFFER_ODD);
 	}
 	context->sprite_draws = MAX_SPRITES_LINE;
 	context->fifo_write = 0;
@@ -340,11 +388,13 @@ vdp_context *init_vdp_context(uint8_t region_pal, uint8_t has_max_vsram, uint8_t
 	}
 	update_video_params(context);
 	context->output = (uint32_t *)(((char *)context->fb) + context->output_pitch * context->border_top);
+	stage_output(context);
 	return context;
 }
 
 void vdp_free(vdp_context *context)
 {
+	vdp_enable_pipeline(context, 0);
 	if (headless) {
 		free(context->fb);
 	}
@@ -1050,12 +1100,43 @@ void vdp_check_update_sat_byte(vdp_context *context, uint32_t address, uint8_t v
 	}
 }
 
+static void mark_tile_dirty(vdp_context *context, uint32_t address)
+{
+	uint32_t row = address >> 2;
+	context->tile_dirty[row >> 5] |= 1 << (row & 31);
+}
+
+void vdp_invalidate_tile_cache(vdp_context *context)
+{
+	memset(context->tile_dirty, 0xFF, sizeof(context->tile_dirty));
+}
+
+//Returns the 8 pixels of the tile row at address, one per byte with the leftmost pixel in the low byte
+static uint64_t tile_row(vdp_context *context, uint16_t address)
+{
+	uint32_t row = address >> 2;
+	uint32_t bit = 1 << (row & 31);
+	if (context->tile_dirty[row >> 5] & bit) {
+		context->tile_dirty[row >> 5] &= ~bit;
+		uint8_t *src = context->vdpmem + (row << 2);
+		uint64_t pixels = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			pixels |= (uint64_t)(src[i] >> 4) << (i * 16);
+			pixels |= (uint64_t)(src[i] & 0xF) << (i * 16 + 8);
+		}
+		context->tile_rows[row] = pixels;
+	}
+	return context->tile_rows[row];
+}
+
 static void write_vram_word(vdp_context *context, uint32_t address, uint16_t value)
 {
 	address = (address & 0x3FC) | (address >> 1 & 0xFC01) | (address >> 9 & 0x2);
 	address ^= 1;
 	//TODO: Support an option to actually have 128KB of VRAM
 	context->vdpmem[address] = value;
+	mark_tile_dirty(context, address);
 }
 
 static void write_vram_byte(vdp_context *context, uint32_t address, uint8_t value)
@@ -1066,13 +1147,54 @@ static void write_vram_byte(vdp_context *context, uint32_t address, uint8_t valu
 		address = mode4_address_map[address & 0x3FFF];
 	}
 	context->vdpmem[address] = value;
+	mark_tile_dirty(context, address);
 }
 
 #define DMA_FILL 0x80
 #define DMA_COPY 0xC0
 #define DMA_TYPE_MASK 0xC0
+static void pipeline_record(vdp_context *context, uint8_t type, uint32_t address, uint16_t value)
+{
+	if (context->replica) {
+		vdp_pipeline_push(context->pipeline, type, context->cycles, address, value);
+	}
+}
+
+//Applies a memory write recorded by the emulated VDP to its pipeline replica
+static void apply_replay(vdp_context *context, pipeline_entry *entry)
+{
+	switch (entry->type)
+	{
+	case PIPELINE_VRAM_WORD:
+		vdp_check_update_sat(context, entry->address, entry->value);
+		write_vram_word(context, entry->address, entry->value);
+		break;
+	case PIPELINE_VRAM_BYTE:
+		vdp_check_update_sat_byte(context, entry->address, entry->value);
+		write_vram_byte(context, entry->address, entry->value);
+		break;
+	case PIPELINE_VRAM_COPY:
+		write_vram_byte(context, entry->address, entry->value);
+		break;
+	case PIPELINE_CRAM:
+		write_cram(context, entry->address, entry->value);
+		break;
+	case PIPELINE_VSRAM:
+		context->vsram[entry->address] = entry->value;
+		break;
+	}
+}
+
 static void external_slot(vdp_context * context)
 {
+	if (context->replaying) {
+		//the replica has no FIFO or DMA of its own, it just repeats writes in the slot they happened in
+		if (context->replay && context->replay->type != PIPELINE_FRAME && context->replay->cycle <= context->cycles) {
+			apply_replay(context, context->replay);
+			context->replay = NULL;
+		}
+		return;
+	}
 	if ((context->flags & FLAG_DMA_RUN) && (context->regs[REG_DMASRC_H] & DMA_TYPE_MASK) == DMA_FILL && context->fifo_read < 0) {
 		context->fifo_read = (context->fifo_write-1) & (FIFO_SIZE-1);
 		fifo_entry * cur = context->fifo + context->fifo_read;
@@ -1088,12 +1210,14 @@ static void external_slot(vdp_context * context)
 		case VRAM_WRITE:
 			if ((context->regs[REG_MODE_2] & (BIT_128K_VRAM|BIT_MODE_5)) == (BIT_128K_VRAM|BIT_MODE_5)) {
 				event_vram_word(context->cycles, start->address, start->value);
+				pipeline_record(context, PIPELINE_VRAM_WORD, start->address, start->value);
 				vdp_check_update_sat(context, start->address, start->value);
 				write_vram_word(context, start->address, start->value);
 			} else {
 				uint8_t byte = start->partial == 1 ? start->value >> 8 : start->value;
 				uint32_t address = start->address ^ 1;
 				event_vram_byte(context->cycles, start->address, byte, context->regs[REG_AUTOINC]);
+				pipeline_record(context, PIPELINE_VRAM_BYTE, address, byte);
 				vdp_check_update_sat_byte(context, address, byte);
 				write_vram_byte(context, address, byte);
 				if (!start->partial) {
@@ -1126,6 +1250,7 @@ static void external_slot(vdp_context * context)
 			}
 			uint8_t buffer[3] = {start->address & 127, val >> 8, val};
 			event_log(EVENT_VDP_INTRAM, context->cycles, sizeof(buffer), buffer);
+			pipeline_record(context, PIPELINE_CRAM, start->address, val);
 			write_cram(context, start->address, val);
 			break;
 		}
@@ -1145,6 +1270,7 @@ static void external_slot(vdp_context * context)
 				}
 				uint8_t buffer[3] = {((start->address/2) & 63) + 128, context->vsram[(start->address/2) & 63] >> 8, context->vsram[(start->address/2) & 63]};
 				event_log(EVENT_VDP_INTRAM, context->cycles, sizeof(buffer), buffer);
+				pipeline_record(context, PIPELINE_VSRAM, (start->address/2) & 63, context->vsram[(start->address/2) & 63]);
 			}
 
 			break;
@@ -1166,6 +1292,7 @@ static void external_slot(vdp_context * context)
 		}
 	} else if ((context->flags & FLAG_DMA_RUN) && (context->regs[REG_DMASRC_H] & DMA_TYPE_MASK) == DMA_COPY) {
 		if (context->flags & FLAG_READ_FETCHED) {
+			pipeline_record(context, PIPELINE_VRAM_COPY, context->address ^ 1, context->prefetch);
 			write_vram_byte(context, context->address ^ 1, context->prefetch);
 
 			//Update DMA state
@@ -1245,7 +1372,7 @@ static void run_dma_src(vdp_context * context, int32_t slot)
 			cur = context->fifo + context->fifo_write;
 			cur->cycle = context->cycles + ((context->regs[REG_MODE_4] & BIT_H40) ? 16 : 20)*FIFO_LATENCY;
 			cur->address = context->address;
-			cur->value = read_dma_value((context->regs[REG_DMASRC_H] << 16) | (context->regs[REG_DMASRC_M] << 8) | context->regs[REG_DMASRC_L]);
+			cur->value = read_dma_value(context->system, (context->regs[REG_DMASRC_H] << 16) | (context->regs[REG_DMASRC_M] << 8) | context->regs[REG_DMASRC_L]);
 			cur->cd = context->cd;
 			cur->partial = 0;
 			if (context->fifo_read < 0) {
@@ -1430,28 +1557,13 @@ static void render_map(uint16_t col, uint8_t * tmp_buf, uint8_t offset, vdp_cont
 		address += 4 * context->v_offset;
 	}
 	uint8_t pal_priority = (col >> 9) & 0x70;
-	uint32_t bits = *((uint32_t *)(&context->vdpmem[address]));
-	tmp_buf += offset;
+	uint64_t pixels = tile_row(context, address);
 	if (col & MAP_BIT_H_FLIP) {
-		uint32_t shift = 28;
-		for (int i = 0; i < 4; i++)
-		{
-			uint8_t right = pal_priority | ((bits >> shift) & 0xF);
-			shift -= 4;
-			*(tmp_buf++) = pal_priority | ((bits >> shift) & 0xF);
-			shift -= 4;
-			*(tmp_buf++) = right;
-		}
-	} else {
-		for (int i = 0; i < 4; i++)
-		{
-			uint8_t right = pal_priority | (bits & 0xF);
-			bits >>= 4;
-			*(tmp_buf++) = pal_priority | (bits & 0xF);
-			bits >>= 4;
-			*(tmp_buf++) = right;
-		}
+		//one pixel per byte, so a horizontal flip is just a byte swap
+		pixels = __builtin_bswap64(pixels);
 	}
+	pixels |= pal_priority * 0x0101010101010101ULL;
+	memcpy(tmp_buf + offset, &pixels, sizeof(pixels));
 }
 
 static void render_map_1(vdp_context * context)
@@ -1546,6 +1658,157 @@ static sh_pixel composite_highlight(vdp_context *context, uint8_t *debug_dst, ui
 	return (sh_pixel){.index = pixel, .intensity = intensity};
 }
 
+//Copies 16 pixels from a scroll buffer starting at off, wrapping at mask, so they can be composited as a block
+static void gather_scroll_pixels(uint8_t *dst, uint8_t *buf, int off, int mask)
+{
+	off &= mask;
+	int first = mask + 1 - off;
+	if (first >= 16) {
+		memcpy(dst, buf + off, 16);
+	} else {
+		memcpy(dst, buf + off, first);
+		memcpy(dst + first, buf, 16 - first);
+	}
+}
+
+//Block versions of composite_normal and composite_highlight for 16 pixels. These skip the layer
+//source output so they are only used when the composite debug view is closed
+static void composite_normal_block(uint8_t *dst, uint8_t *sprite, uint8_t *plane_a, uint8_t *plane_b, uint8_t bg_index)
+{
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128();
+	__m128i low = _mm_set1_epi8(0xF);
+	__m128i priority = _mm_set1_epi8(BUF_BIT_PRIORITY);
+	__m128i s = _mm_loadu_si128((__m128i *)sprite);
+	__m128i a = _mm_loadu_si128((__m128i *)plane_a);
+	__m128i b = _mm_loadu_si128((__m128i *)plane_b);
+	__m128i pixel = _mm_set1_epi8(bg_index);
+	//each keep mask is set where the current pixel stays on top of the next layer
+	__m128i keep = _mm_cmpeq_epi8(_mm_and_si128(b, low), zero);
+	pixel = _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, b));
+	__m128i pixel_pri = _mm_cmpeq_epi8(_mm_and_si128(pixel, priority), priority);
+	keep = _mm_or_si128(
+		_mm_cmpeq_epi8(_mm_and_si128(a, low), zero),
+		_mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(a, priority), priority), pixel_pri)
+	);
+	pixel = _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, a));
+	pixel_pri = _mm_cmpeq_epi8(_mm_and_si128(pixel, priority), priority);
+	keep = _mm_or_si128(
+		_mm_cmpeq_epi8(_mm_and_si128(s, low), zero),
+		_mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(s, priority), priority), pixel_pri)
+	);
+	pixel = _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, s));
+	_mm_storeu_si128((__m128i *)dst, _mm_and_si128(pixel, _mm_set1_epi8(0x3F)));
+#elif defined(__ARM_NEON)
+	uint8x16_t low = vdupq_n_u8(0xF);
+	uint8x16_t priority = vdupq_n_u8(BUF_BIT_PRIORITY);
+	uint8x16_t s = vld1q_u8(sprite);
+	uint8x16_t a = vld1q_u8(plane_a);
+	uint8x16_t b = vld1q_u8(plane_b);
+	uint8x16_t pixel = vdupq_n_u8(bg_index);
+	//each take mask is set where the next layer ends up on top of the current pixel
+	uint8x16_t take = vtstq_u8(b, low);
+	pixel = vbslq_u8(take, b, pixel);
+	take = vandq_u8(vtstq_u8(a, low), vcgeq_u8(vandq_u8(a, priority), vandq_u8(pixel, priority)));
+	pixel = vbslq_u8(take, a, pixel);
+	take = vandq_u8(vtstq_u8(s, low), vcgeq_u8(vandq_u8(s, priority), vandq_u8(pixel, priority)));
+	pixel = vbslq_u8(take, s, pixel);
+	vst1q_u8(dst, vandq_u8(pixel, vdupq_n_u8(0x3F)));
+#else
+	uint8_t debug;
+	for (int i = 0; i < 16; i++)
+	{
+		dst[i] = composite_normal(NULL, &debug, sprite[i], plane_a[i], plane_b[i], bg_index) & 0x3F;
+	}
+#endif
+}
+
+static void composite_highlight_block(uint8_t *dst, uint8_t *sprite, uint8_t *plane_a, uint8_t *plane_b, uint8_t bg_index)
+{
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128();
+	__m128i low = _mm_set1_epi8(0xF);
+	__m128i color = _mm_set1_epi8(0x3F);
+	__m128i priority = _mm_set1_epi8(BUF_BIT_PRIORITY);
+	__m128i s = _mm_loadu_si128((__m128i *)sprite);
+	__m128i a = _mm_loadu_si128((__m128i *)plane_a);
+	__m128i b = _mm_loadu_si128((__m128i *)plane_b);
+	__m128i pixel = _mm_set1_epi8(bg_index);
+	__m128i keep = _mm_cmpeq_epi8(_mm_and_si128(b, low), zero);
+	pixel = _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, b));
+	__m128i intensity = _mm_or_si128(_mm_and_si128(b, priority), _mm_and_si128(a, priority));
+	__m128i pixel_pri = _mm_cmpeq_epi8(_mm_and_si128(pixel, priority), priority);
+	keep = _mm_or_si128(
+		_mm_cmpeq_epi8(_mm_and_si128(a, low), zero),
+		_mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(a, priority), priority), pixel_pri)
+	);
+	pixel = _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, a));
+	pixel_pri = _mm_cmpeq_epi8(_mm_and_si128(pixel, priority), priority);
+	keep = _mm_or_si128(
+		_mm_cmpeq_epi8(_mm_and_si128(s, low), zero),
+		_mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(s, priority), priority), pixel_pri)
+	);
+	//sprite colors 0x3E and 0x3F are the highlight and shadow operators rather than visible pixels
+	__m128i s_color = _mm_and_si128(s, color);
+	__m128i highlight = _mm_andnot_si128(keep, _mm_cmpeq_epi8(s_color, _mm_set1_epi8(0x3E)));
+	__m128i shadow = _mm_andnot_si128(keep, _mm_cmpeq_epi8(s_color, _mm_set1_epi8(0x3F)));
+	intensity = _mm_add_epi8(intensity, _mm_and_si128(highlight, priority));
+	intensity = _mm_andnot_si128(shadow, intensity);
+	keep = _mm_or_si128(keep, _mm_or_si128(highlight, shadow));
+	__m128i normal = _mm_cmpeq_epi8(_mm_and_si128(s, low), _mm_set1_epi8(0xE));
+	__m128i s_intensity = _mm_or_si128(
+		_mm_and_si128(normal, priority),
+		_mm_andnot_si128(normal, _mm_or_si128(intensity, _mm_and_si128(s, priority)))
+	);
+	intensity = _mm_or_si128(_mm_and_si128(keep, intensity), _mm_andnot_si128(keep, s_intensity));
+	pixel = _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, s));
+	pixel = _mm_and_si128(pixel, color);
+	pixel = _mm_add_epi8(pixel, _mm_and_si128(_mm_cmpeq_epi8(intensity, _mm_set1_epi8(BUF_BIT_PRIORITY << 1)), _mm_set1_epi8(HIGHLIGHT_OFFSET)));
+	pixel = _mm_add_epi8(pixel, _mm_and_si128(_mm_cmpeq_epi8(intensity, zero), _mm_set1_epi8(SHADOW_OFFSET)));
+	_mm_storeu_si128((__m128i *)dst, pixel);
+#elif defined(__ARM_NEON)
+	uint8x16_t low = vdupq_n_u8(0xF);
+	uint8x16_t color = vdupq_n_u8(0x3F);
+	uint8x16_t priority = vdupq_n_u8(BUF_BIT_PRIORITY);
+	uint8x16_t s = vld1q_u8(sprite);
+	uint8x16_t a = vld1q_u8(plane_a);
+	uint8x16_t b = vld1q_u8(plane_b);
+	uint8x16_t pixel = vdupq_n_u8(bg_index);
+	uint8x16_t take = vtstq_u8(b, low);
+	pixel = vbslq_u8(take, b, pixel);
+	uint8x16_t intensity = vandq_u8(vorrq_u8(a, b), priority);
+	take = vandq_u8(vtstq_u8(a, low), vcgeq_u8(vandq_u8(a, priority), vandq_u8(pixel, priority)));
+	pixel = vbslq_u8(take, a, pixel);
+	take = vandq_u8(vtstq_u8(s, low), vcgeq_u8(vandq_u8(s, priority), vandq_u8(pixel, priority)));
+	//sprite colors 0x3E and 0x3F are the highlight and shadow operators rather than visible pixels
+	uint8x16_t s_color = vandq_u8(s, color);
+	uint8x16_t highlight = vandq_u8(take, vceqq_u8(s_color, vdupq_n_u8(0x3E)));
+	uint8x16_t shadow = vandq_u8(take, vceqq_u8(s_color, vdupq_n_u8(0x3F)));
+	intensity = vaddq_u8(intensity, vandq_u8(highlight, priority));
+	intensity = vbicq_u8(intensity, shadow);
+	take = vbicq_u8(take, vorrq_u8(highlight, shadow));
+	uint8x16_t s_intensity = vbslq_u8(vceqq_u8(vandq_u8(s, low), vdupq_n_u8(0xE)), priority, vorrq_u8(intensity, vandq_u8(s, priority)));
+	intensity = vbslq_u8(take, s_intensity, intensity);
+	pixel = vandq_u8(vbslq_u8(take, s, pixel), color);
+	pixel = vaddq_u8(pixel, vandq_u8(vceqq_u8(intensity, vdupq_n_u8(BUF_BIT_PRIORITY << 1)), vdupq_n_u8(HIGHLIGHT_OFFSET)));
+	pixel = vaddq_u8(pixel, vandq_u8(vceqq_u8(intensity, vdupq_n_u8(0)), vdupq_n_u8(SHADOW_OFFSET)));
+	vst1q_u8(dst, pixel);
+#else
+	uint8_t debug;
+	for (int i = 0; i < 16; i++)
+	{
+		sh_pixel pixel = composite_highlight(NULL, &debug, sprite[i], plane_a[i], plane_b[i], bg_index);
+		if (pixel.intensity == BUF_BIT_PRIORITY << 1) {
+			dst[i] = (pixel.index & 0x3F) + HIGHLIGHT_OFFSET;
+		} else if (pixel.intensity) {
+			dst[i] = pixel.index & 0x3F;
+		} else {
+			dst[i] = (pixel.index & 0x3F) + SHADOW_OFFSET;
+		}
+	}
+#endif
+}
+
 static void render_normal(vdp_context *context, int32_t col, uint8_t *dst, uint8_t *debug_dst, uint8_t *buf_a, int plane_a_off, int plane_a_mask, int plane_b_off)
 {
 	uint8_t *sprite_buf = context->linebuf + col * 8;
@@ -1565,6 +1828,11 @@ static void render_normal(vdp_context *context, int32_t col, uint8_t *dst, uint8
 			*(dst++) = composite_normal(context, debug_dst, *sprite_buf, plane_a, plane_b, context->regs[REG_BG_COLOR]) & 0x3F;
 			debug_dst++;
 		}
+	} else if (!(context->enabled_debuggers & (1 << DEBUG_COMPOSITE))) {
+		uint8_t plane_a[16], plane_b[16];
+		gather_scroll_pixels(plane_a, buf_a, plane_a_off, plane_a_mask);
+		gather_scroll_pixels(plane_b, context->tmp_buf_b, plane_b_off, SCROLL_BUFFER_MASK);
+		composite_normal_block(dst, sprite_buf, plane_a, plane_b, context->regs[REG_BG_COLOR]);
 	} else {
 		for (int i = 0; i < 16; ++plane_a_off, ++plane_b_off, ++sprite_buf, ++i)
 		{
@@ -1586,6 +1854,12 @@ static void render_highlight(vdp_context *context, int32_t col, uint8_t *dst, ui
 		dst += 8;
 		debug_dst += 8;
 		start = 8;
+	} else if (!(context->enabled_debuggers & (1 << DEBUG_COMPOSITE))) {
+		uint8_t plane_a[16], plane_b[16];
+		gather_scroll_pixels(plane_a, buf_a, plane_a_off, plane_a_mask);
+		gather_scroll_pixels(plane_b, context->tmp_buf_b, plane_b_off, SCROLL_BUFFER_MASK);
+		composite_highlight_block(dst, context->linebuf + col * 8, plane_a, plane_b, context->regs[REG_BG_COLOR]);
+		return;
 	}
 	uint8_t *sprite_buf = context->linebuf + col * 8 + start;
 	for (int i = start; i < 16; ++plane_a_off, ++plane_b_off, ++sprite_buf, ++i)
@@ -1831,6 +2105,11 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 	}
 	line &= 0xFF;
 	render_map(context->col_2, context->tmp_buf_b, context->buf_b_off+8, context);
+	if (SKIP_PIXELS(context)) {
+		context->buf_a_off = (context->buf_a_off + SCROLL_BUFFER_DRAW) & SCROLL_BUFFER_MASK;
+		context->buf_b_off = (context->buf_b_off + SCROLL_BUFFER_DRAW) & SCROLL_BUFFER_MASK;
+		return;
+	}
 	uint8_t *sprite_buf;
 	uint8_t sprite, plane_a, plane_b;
 	int plane_a_off, plane_b_off;
@@ -2195,16 +2474,12 @@ static void vram_debug_mode5(uint32_t *fb, uint32_t pitch, vdp_context *context)
 		int yoff = y >> 1 & ymask;
 		for (int col = 0; col < 64; col++)
 		{
-			uint16_t address = (row * 64 + col) * tilesize + yoff * 4;
-			for (int x = 0; x < 4; x++)
+			uint64_t pixels = tile_row(context, (row * 64 + col) * tilesize + yoff * 4);
+			for (int x = 0; x < 8; x++, pixels >>= 8)
 			{
-				uint8_t byte = context->vdpmem[address++];
-				uint8_t left = byte >> 4 | pal;
-				uint8_t right = byte & 0xF | pal;
-				*(line++) = context->colors[left];
-				*(line++) = context->colors[left];
-				*(line++) = context->colors[right];
-				*(line++) = context->colors[right];
+				uint32_t color = context->colors[(pixels & 0xF) | pal];
+				*(line++) = color;
+				*(line++) = color;
 			}
 		}
 	}
@@ -2341,29 +2616,17 @@ static void plane_debug_mode5(uint32_t *fb, uint32_t pitch, vdp_context *context
 				y_diff = -4;
 				address += (num_lines - 1) * 4;
 			}
-			int x_diff = 1;
-			if (entry & 0x800) {
-				x_diff = -1;
-				address += 3;
-			}
 			for (int y = 0; y < num_lines; y++)
 			{
-				uint16_t trow_address = address;
+				uint64_t pixels = tile_row(context, address);
+				if (entry & 0x800) {
+					pixels = __builtin_bswap64(pixels);
+				}
 				uint32_t *row_dst = dst;
-				for (int x = 0; x < 4; x++)
+				for (int x = 0; x < 8; x++, pixels >>= 8)
 				{
-					uint8_t byte = context->vdpmem[trow_address];
-					trow_address += x_diff;
-					uint8_t left, right;
-					if (x_diff > 0) {
-						left = byte >> 4;
-						right = byte & 0xF;
-					} else {
-						left = byte & 0xF;
-						right = byte >> 4;
-					}
-					*(row_dst++) = left ? context->colors[left|pal] : bg_color;
-					*(row_dst++) = right ? context->colors[right|pal] : bg_color;
+					uint8_t pixel = pixels & 0xF;
+					*(row_dst++) = pixel ? context->colors[pixel|pal] : bg_color;
 				}
 				address += y_diff;
 				dst += pitch / sizeof(uint32_t);
@@ -2801,6 +3064,11 @@ void vdp_force_update_framebuffer(vdp_context *context)
 	if (!context->fb) {
 		return;
 	}
+	if (context->replica) {
+		vdp_pipeline_drain(context->pipeline);
+		flush_output_line(context->replica);
+	}
+	flush_output_line(context);
 	uint16_t lines_max = context->inactive_start + context->border_bot + context->border_top;
 
 	uint16_t to_fill = lines_max - context->output_lines;
@@ -2811,11 +3079,26 @@ void vdp_force_update_framebuffer(vdp_context *context)
 	);
 	render_framebuffer_updated(context->cur_buffer, context->h40_lines > context->output_lines / 2 ? LINEBUF_SIZE : (256+HORIZ_BORDER));
 	context->fb = render_get_framebuffer(context->cur_buffer, &context->output_pitch);
+	if (context->replica) {
+		context->replica->fb = context->fb;
+		context->replica->output_pitch = context->output_pitch;
+	}
 	vdp_update_per_frame_debug(context);
 }
 
+//The replica draws the real line, the emulated VDP gets a scratch line so that it never writes
+//to a framebuffer the worker is using
+static void defer_output(vdp_context *context)
+{
+	if (context->replica) {
+		context->pipeline_output = context->output;
+		context->output = context->pipeline_scratch;
+	}
+}
+
 static void advance_output_line(vdp_context *context)
 {
+	flush_output_line(context);
 	//This function is kind of gross because of the need to deal with vertical border busting via mode changes
 	uint16_t lines_max = context->inactive_start + context->border_bot + context->border_top;
 	uint32_t output_line = context->vcounter;
@@ -2826,8 +3109,27 @@ static void advance_output_line(vdp_context *context)
 
 	if (context->output_lines >= lines_max || (!context->pushed_frame && output_line == context->inactive_start + context->border_top)) {
 		//we've either filled up a full frame or we're at the bottom of screen in the current defined mode + border crop
-		if (!headless) {
-			render_framebuffer_updated(context->cur_buffer, context->h40_lines > (context->inactive_start + context->border_top) / 2 ? LINEBUF_SIZE : (256+HORIZ_BORDER));
+		if (context->replica) {
+			pipeline_record(context, PIPELINE_FRAME, 0, context->output_suppressed);
+			if (!context->output_suppressed && !headless) {
+				vdp_pipeline_wait_frame(context->pipeline);
+			}
+		} else if (context->replay && context->replay->type == PIPELINE_FRAME) {
+			context->output_suppressed = context->replay->value;
+			context->replay = NULL;
+		} else if (context->replaying && !context->output_suppressed && !headless) {
+			//replay_pipeline must not signal again when it gets to this frame's entry
+			context->early_frames++;
+		}
+		if (context->output_suppressed) {
+			//frame is discarded, keep drawing into the same framebuffer
+			context->pushed_frame = 1;
+		} else if (!headless) {
+			if (context->replaying) {
+				vdp_pipeline_frame_done(context->pipeline);
+			} else {
+				render_framebuffer_updated(context->cur_buffer, context->h40_lines > (context->inactive_start + context->border_top) / 2 ? LINEBUF_SIZE : (256+HORIZ_BORDER));
+			}
 			uint8_t is_even = context->flags2 & FLAG2_EVEN_FIELD;
 			if (context->vcounter <= context->inactive_start && (context->regs[REG_MODE_4] & BIT_INTERLACE)) {
 				is_even = !is_even;
@@ -2863,10 +3165,23 @@ static void advance_output_line(vdp_context *context)
 		output_line = context->output_lines++;//context->vcounter - (0x200 - context->border_top);
 	} else {
 		context->output = NULL;
+		defer_output(context);
 		return;
 	}
 	if (!context->fb) {
-		context->fb = render_get_framebuffer(context->cur_buffer, &context->output_pitch);
+		if (context->replaying) {
+			context->fb = vdp_pipeline_take_framebuffer(context->pipeline, &context->output_pitch);
+			if (!context->fb) {
+				//pipeline is being stopped
+				context->output = NULL;
+				return;
+			}
+		} else {
+			context->fb = render_get_framebuffer(context->cur_buffer, &context->output_pitch);
+			if (context->replica) {
+				vdp_pipeline_give_framebuffer(context->pipeline, context->fb, context->output_pitch);
+			}
+		}
 	}
 	output_line += context->top_offset;
 	context->output = (uint32_t *)(((char *)context->fb) + context->output_pitch * output_line);
@@ -2879,18 +3194,55 @@ static void advance_output_line(vdp_context *context)
 	if (context->output && (context->regs[REG_MODE_4] & BIT_H40)) {
 		context->h40_lines++;
 	}
+	defer_output(context);
+	stage_output(context);
 }
 
 void vdp_release_framebuffer(vdp_context *context)
 {
+	if (context->replica) {
+		vdp_pipeline_drain(context->pipeline);
+		flush_output_line(context->replica);
+		context->replica->output = context->replica->fb = NULL;
+	}
+	flush_output_line(context);
 	if (context->fb) {
 		render_framebuffer_updated(context->cur_buffer, context->h40_lines > (context->inactive_start + context->border_top) / 2 ? LINEBUF_SIZE : (256+HORIZ_BORDER));
 		context->output = context->fb = NULL;
+		defer_output(context);
 	}
 }
 
+//Suppressed frames are rendered but never presented, used for run-ahead frames
+void vdp_set_output_suppressed(vdp_context *context, uint8_t suppressed)
+{
+	context->output_suppressed = suppressed;
+	//the replica skips drawing based on this so it needs to see the change when the frame starts
+	pipeline_record(context, PIPELINE_SUPPRESS, 0, suppressed);
+}
+
+//Output position within the framebuffer is not part of the serialized state
+//These are used to keep it consistent when returning to a state taken earlier in the same session
+void vdp_mark_output_position(vdp_context *context)
+{
+	context->mark_output_lines = context->output_lines;
+	context->mark_h40_lines = context->h40_lines;
+	context->mark_pushed_frame = context->pushed_frame;
+}
+
+void vdp_restore_output_position(vdp_context *context)
+{
+	context->output_lines = context->mark_output_lines;
+	context->h40_lines = context->mark_h40_lines;
+	context->pushed_frame = context->mark_pushed_frame;
+	vdp_resync_pipeline(context);
+}
+
 void vdp_reacquire_framebuffer(vdp_context *context)
 {
+	if (context->replica) {
+		vdp_pipeline_drain(context->pipeline);
+	}
 	uint16_t lines_max = context->inactive_start + context->border_bot + context->border_top;
 	if (context->output_lines <= lines_max && context->output_lines > 0) {
 		context->fb = render_get_framebuffer(context->cur_buffer, &context->output_pitch);
@@ -2898,6 +3250,16 @@ void vdp_reacquire_framebuffer(vdp_context *context)
 	} else {
 		context->output = NULL;
 	}
+	if (context->replica) {
+		context->replica->fb = context->fb;
+		context->replica->output_pitch = context->output_pitch;
+		context->replica->output = context->output;
+		defer_output(context);
+		//line_stage still holds the start of the current line from before the release
+		stage_output(context->replica);
+	} else {
+		stage_output(context);
+	}
 }
 
 static void render_border_garbage(vdp_context *context, uint32_t address, uint8_t *buf, uint8_t buf_off, uint16_t col)
@@ -3235,6 +3597,14 @@ static void draw_right_border(vdp_context *context)
 		context->cycles += slot_cycles;\
 		if ((slot+1) == LINE_CHANGE_MODE4) {\
 			vdp_advance_line(context);\
+			if (can_run_whole_line(context)) {\
+				while (\
+					target_cycles - context->cycles >= MCLKS_LINE && context->state != PREPARING\
+					&& context->vcounter != 192 && context->vcounter != context->inactive_start\
+				) {\
+					vdp_h32_mode4_line(context);\
+				}\
+			}\
 			if (context->vcounter == 192) {\
 				return;\
 			}\
@@ -3270,6 +3640,18 @@ static void draw_right_border(vdp_context *context)
 		MODE4_CHECK_SLOT_LINE(CALC_SLOT(slot, 5))
 
 static uint32_t dummy_buffer[LINEBUF_SIZE];
+
+//only consider doing a line at a time if the FIFO is empty, there are no pending reads and there is no DMA running
+//CD1 without CD0 (left behind by register writes) is not a read mode so external slots have nothing to do either
+static uint8_t can_run_whole_line(vdp_context *context)
+{
+	if (context->replaying) {
+		//whole lines skip the external slots, so only take that path when there's no write to place in one
+		return !context->replay || context->replay->type == PIPELINE_FRAME;
+	}
+	return context->fifo_read == -1 && !(context->flags & FLAG_DMA_RUN) && ((context->cd & 3) || (context->flags & FLAG_READ_FETCHED));
+}
+
 static void vdp_h40_line(vdp_context * context)
 {
 	uint16_t address;
@@ -3456,7 +3838,7 @@ static void vdp_h40_line(vdp_context * context)
 	context->cycles += MCLKS_LINE;
 	vdp_advance_line(context);
 	src = context->compositebuf;
-	if (!context->output) {
+	if (!context->output || context->output_suppressed || SKIP_PIXELS(context)) {
 		return;
 	}
 	dst = context->output;
@@ -3493,8 +3875,7 @@ static void vdp_h40(vdp_context * context, uint32_t target_cycles)
 	for (;;)
 	{
 	case 165:
-		//only consider doing a line at a time if the FIFO is empty, there are no pending reads and there is no DMA running
-		if (context->fifo_read == -1 && !(context->flags & FLAG_DMA_RUN) && ((context->cd & 1) || (context->flags & FLAG_READ_FETCHED))) {
+		if (can_run_whole_line(context)) {
 			while (target_cycles - context->cycles >= MCLKS_LINE && context->state != PREPARING && context->vcounter != context->inactive_start) {
 				vdp_h40_line(context);
 			}
@@ -3706,6 +4087,225 @@ static void vdp_h40(vdp_context * context, uint32_t target_cycles)
 	}
 }
 
+static void vdp_h32_line(vdp_context * context)
+{
+	uint16_t address;
+	uint32_t mask;
+	uint8_t bgindex = context->regs[REG_BG_COLOR] & 0x3F;
+	uint8_t test_layer = context->test_regs[0] >> 7 & 3;
+
+	//133
+	render_sprite_cells(context);
+	//134
+	render_sprite_cells(context);
+	//135
+	context->sprite_index = 0x80;
+	context->slot_counter = 0;
+	render_sprite_cells(context);
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_b, context->buf_b_off,
+		context->col_1
+	);
+	scan_sprite_table(context->vcounter, context);
+	//136
+	render_sprite_cells(context);
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_b,
+		context->buf_b_off + 8,
+		context->col_2
+	);
+	scan_sprite_table(context->vcounter, context);
+	//137
+	render_sprite_cells(context);
+	draw_right_border(context);
+	scan_sprite_table(context->vcounter, context);
+	//138-144 (inclusive), 145 is an external slot
+	for (int i = 0; i < 7; i++)
+	{
+		render_sprite_cells(context);
+		scan_sprite_table(context->vcounter, context);
+	}
+	//146
+	render_sprite_cells(context);
+	scan_sprite_table(context->vcounter, context);
+
+	//Do palette lookup for end of previous line
+	uint8_t *src = context->compositebuf + (LINE_CHANGE_H32 - BG_START_SLOT) *2;
+	uint32_t *dst = context->output + (LINE_CHANGE_H32 - BG_START_SLOT) *2;
+	if (context->output) {
+		if (test_layer) {
+			for (int i = 0; i < 256 + HORIZ_BORDER - (LINE_CHANGE_H32 - BG_START_SLOT) * 2; i++)
+			{
+				*(dst++) = context->colors[*(src++)];
+			}
+		} else {
+			for (int i = 0; i < 256 + HORIZ_BORDER - (LINE_CHANGE_H32 - BG_START_SLOT) * 2; i++)
+			{
+				if (*src & 0x3F) {
+					*(dst++) = context->colors[*(src++)];
+				} else {
+					*(dst++) = context->colors[(*(src++) & 0xC0) | bgindex];
+				}
+			}
+		}
+	}
+	context->done_composite = NULL;
+	advance_output_line(context);
+	if (!context->output) {
+		context->output = dummy_buffer;
+	}
+	//147
+	render_sprite_cells(context);
+	scan_sprite_table(context->vcounter, context);
+	//233-242 (inclusive)
+	for (int i = 0; i < 10; i++)
+	{
+		render_sprite_cells(context);
+		scan_sprite_table(context->vcounter, context);
+	}
+	//243
+	if (!(context->regs[REG_MODE_3] & BIT_VSCROLL)) {
+		//See note in vdp_h32 about when this latch happens
+		context->vscroll_latch[0] = context->vsram[0];
+		context->vscroll_latch[1] = context->vsram[1];
+	}
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_a,
+		context->buf_a_off,
+		context->col_1
+	);
+	//244
+	address = (context->regs[REG_HSCROLL] & 0x3F) << 10;
+	mask = 0;
+	if (context->regs[REG_MODE_3] & 0x2) {
+		mask |= 0xF8;
+	}
+	if (context->regs[REG_MODE_3] & 0x1) {
+		mask |= 0x7;
+	}
+	render_border_garbage(context, address, context->tmp_buf_a, context->buf_a_off+8, context->col_2);
+	address += (context->vcounter & mask) * 4;
+	context->hscroll_a = context->vdpmem[address] << 8 | context->vdpmem[address+1];
+	context->hscroll_a_fine = context->hscroll_a & 0xF;
+	context->hscroll_b = context->vdpmem[address+2] << 8 | context->vdpmem[address+3];
+	context->hscroll_b_fine = context->hscroll_b & 0xF;
+	//245-246 (inclusive)
+	for (int i = 0; i < 2; i++)
+	{
+		render_sprite_cells(context);
+		scan_sprite_table(context->vcounter, context);
+	}
+	//247
+	render_sprite_cells(context);
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_b,
+		context->buf_b_off,
+		context->col_1
+	);
+	scan_sprite_table(context->vcounter, context);
+	//248
+	render_sprite_cells(context);
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_b,
+		context->buf_b_off + 8,
+		context->col_2
+	);
+	context->buf_a_off = (context->buf_a_off + SCROLL_BUFFER_DRAW) & SCROLL_BUFFER_MASK;
+	context->buf_b_off = (context->buf_b_off + SCROLL_BUFFER_DRAW) & SCROLL_BUFFER_MASK;
+	scan_sprite_table(context->vcounter, context);
+	//249
+	read_map_scroll_a(0, context->vcounter, context);
+	//250
+	render_sprite_cells(context);
+	scan_sprite_table(context->vcounter, context);
+	//251
+	render_map_1(context);
+	scan_sprite_table(context->vcounter, context);//Just a guess
+	//252
+	render_map_2(context);
+	scan_sprite_table(context->vcounter, context);//Just a guess
+	//253
+	read_map_scroll_b(0, context->vcounter, context);
+	//254
+	render_sprite_cells(context);
+	scan_sprite_table(context->vcounter, context);
+	//255
+	render_map_3(context);
+	scan_sprite_table(context->vcounter, context);//Just a guess
+	//0
+	render_map_output(context->vcounter, 0, context);
+	scan_sprite_table(context->vcounter, context);//Just a guess
+	context->cur_slot = context->slot_counter;
+	context->sprite_x_offset = 0;
+	context->sprite_draws = MAX_SPRITES_LINE_H32;
+	//background planes and layer compositing
+	for (int col = 2; col < 34; col+=2)
+	{
+		read_map_scroll_a(col, context->vcounter, context);
+		render_map_1(context);
+		render_map_2(context);
+		read_map_scroll_b(col, context->vcounter, context);
+		read_sprite_x(context->vcounter, context);
+		render_map_3(context);
+		render_map_output(context->vcounter, col, context);
+	}
+	//131
+	context->cur_slot = MAX_SPRITES_LINE_H32-1;
+	memset(context->linebuf, 0, LINEBUF_SIZE);
+	context->flags &= ~FLAG_MASKED;
+	while (context->sprite_draws) {
+		context->sprite_draws--;
+		context->sprite_draw_list[context->sprite_draws].x_pos = 0;
+	}
+	render_sprite_cells(context);
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_a, context->buf_a_off,
+		context->col_1
+	);
+	//132
+	render_sprite_cells(context);
+	render_border_garbage(
+		context,
+		context->serial_address,
+		context->tmp_buf_a, context->buf_a_off + 8,
+		context->col_2
+	);
+	context->cycles += MCLKS_LINE;
+	vdp_advance_line(context);
+	src = context->compositebuf;
+	if (context->output_suppressed || SKIP_PIXELS(context)) {
+		return;
+	}
+	dst = context->output;
+	if (test_layer) {
+		for (int i = 0; i < (LINE_CHANGE_H32 - BG_START_SLOT) * 2; i++)
+		{
+			*(dst++) = context->colors[*(src++)];
+		}
+	} else {
+		for (int i = 0; i < (LINE_CHANGE_H32 - BG_START_SLOT) * 2; i++)
+		{
+			if (*src & 0x3F) {
+				*(dst++) = context->colors[*(src++)];
+			} else {
+				*(dst++) = context->colors[(*(src++) & 0xC0) | bgindex];
+			}
+		}
+	}
+}
+
 static void vdp_h32(vdp_context * context, uint32_t target_cycles)
 {
 	uint16_t address;
@@ -3723,6 +4323,12 @@ static void vdp_h32(vdp_context * context, uint32_t target_cycles)
 	for (;;)
 	{
 	case 133:
+		if (can_run_whole_line(context)) {
+			while (target_cycles - context->cycles >= MCLKS_LINE && context->state != PREPARING && context->vcounter != context->inactive_start) {
+				vdp_h32_line(context);
+			}
+			CHECK_ONLY
+		}
 		OUTPUT_PIXEL(133)
 		if (context->state == PREPARING) {
 			external_slot(context);
@@ -3924,6 +4530,95 @@ static void vdp_h32(vdp_context * context, uint32_t target_cycles)
 	}
 }
 
+static void vdp_h32_mode4_line(vdp_context * context)
+{
+	uint8_t bgindex = 0x10 | (context->regs[REG_BG_COLOR] & 0xF) + MODE4_OFFSET;
+
+	//248
+	render_sprite_cells_mode4(context);
+	//249
+	fetch_sprite_cells_mode4(context);
+	//250
+	render_sprite_cells_mode4(context);
+	//252
+	if (context->regs[REG_MODE_1] & BIT_HSCRL_LOCK && context->vcounter < 16) {
+		context->hscroll_a = 0;
+	} else {
+		context->hscroll_a = context->regs[REG_X_SCROLL];
+	}
+	//253
+	context->sprite_index = 0;
+	context->slot_counter = MAX_DRAWS_H32_MODE4;
+	scan_sprite_table_mode4(context);
+	//254-255, 0-3 (inclusive)
+	for (int i = 0; i < 6; i++)
+	{
+		scan_sprite_table_mode4(context);
+	}
+	//4
+	scan_sprite_table_mode4(context);
+	context->buf_a_off = 8;
+	memset(context->tmp_buf_a, 0, 8);
+	//5-132 (inclusive)
+	for (int col = 0; col < 32; col++)
+	{
+		read_map_mode4(col, context->vcounter, context);
+		if (col & 3) {
+			scan_sprite_table_mode4(context);
+		}
+		fetch_map_mode4(col, context->vcounter, context);
+		render_map_mode4(context->vcounter, col, context);
+	}
+	//136
+	memset(context->linebuf, 0, LINEBUF_SIZE);
+	context->cur_slot = context->sprite_index = MAX_DRAWS_H32_MODE4-1;
+	context->sprite_draws = MAX_DRAWS_H32_MODE4;
+	//Do palette lookup for the whole line, the last composited pixel is covered by the right border
+	if (!context->output_suppressed && !SKIP_PIXELS(context)) {
+		uint8_t *src = context->compositebuf + BORDER_LEFT;
+		uint32_t *dst = context->output;
+		for (int i = 0; i < BORDER_LEFT; i++)
+		{
+			*(dst++) = context->colors[bgindex];
+		}
+		for (int i = BORDER_LEFT; i < BORDER_LEFT + 256 - 1; i++)
+		{
+			*(dst++) = context->colors[*(src++)];
+		}
+		for (int i = BORDER_LEFT + 256 - 1; i < 256 + HORIZ_BORDER; i++)
+		{
+			*(dst++) = context->colors[bgindex];
+		}
+	}
+	//137-147, 233
+	for (int i = 0; i < 2; i++)
+	{
+		read_sprite_x_mode4(context);
+		read_sprite_x_mode4(context);
+		fetch_sprite_cells_mode4(context);
+		render_sprite_cells_mode4(context);
+		fetch_sprite_cells_mode4(context);
+		render_sprite_cells_mode4(context);
+	}
+	advance_output_line(context);
+	if (!context->output) {
+		context->output = dummy_buffer;
+	}
+	//239-244
+	read_sprite_x_mode4(context);
+	read_sprite_x_mode4(context);
+	fetch_sprite_cells_mode4(context);
+	render_sprite_cells_mode4(context);
+	fetch_sprite_cells_mode4(context);
+	render_sprite_cells_mode4(context);
+	//245-247
+	read_sprite_x_mode4(context);
+	read_sprite_x_mode4(context);
+	fetch_sprite_cells_mode4(context);
+	context->cycles += MCLKS_LINE;
+	vdp_advance_line(context);
+}
+
 static void vdp_h32_mode4(vdp_context * context, uint32_t target_cycles)
 {
 	uint16_t address;
@@ -4979,6 +5674,9 @@ void vdp_run_context_full(vdp_context * context, uint32_t target_cycles)
 			vdp_inactive(context, target_cycles, is_h40, mode_5);
 		}
 	}
+	if (context->replica) {
+		vdp_pipeline_run(context->pipeline, context->cycles);
+	}
 }
 
 void vdp_run_context(vdp_context *context, uint32_t target_cycles)
@@ -5086,6 +5784,7 @@ void vdp_reg_write(vdp_context *context, uint16_t reg, uint16_t value)
 		}*/
 		uint8_t buffer[2] = {reg, value};
 		event_log(EVENT_VDP_REG, context->cycles, sizeof(buffer), buffer);
+		pipeline_record(context, PIPELINE_REG, reg, value);
 		context->regs[reg] = value;
 		if (reg == REG_MODE_1 || reg == REG_MODE_2 || reg == REG_MODE_4) {
 			update_video_params(context);
@@ -5167,7 +5866,7 @@ int vdp_control_port_write(vdp_context * context, uint16_t value, uint32_t cpu_c
 					//only captures are from a direct color DMA demo which will generally start DMA at a very specific point in display so other values are plausible
 					//sticking with 3 slots for now until I can do some more captures
 					vdp_run_context_full(context, context->cycles + 12 * ((context->regs[REG_MODE_2] & BIT_MODE_5) && (context->regs[REG_MODE_4] & BIT_H40) ? 4 : 5));
-					vdp_dma_started();
+					vdp_dma_started(context->system);
 					context->flags |= FLAG_DMA_RUN;
 					if (context->dma_hook) {
 						context->dma_hook(context);
@@ -5310,6 +6009,7 @@ void vdp_test_port_write(vdp_context * context, uint16_t value)
 {
 	if (context->selected_test_reg < 8) {
 		context->test_regs[context->selected_test_reg] = value;
+		pipeline_record(context, PIPELINE_TEST_REG, context->selected_test_reg, value);
 	}
 }
 
@@ -5426,6 +6126,7 @@ uint8_t vdp_data_port_read_pbc(vdp_context * context)
 
 void vdp_adjust_cycles(vdp_context * context, uint32_t deduction)
 {
+	pipeline_record(context, PIPELINE_ADJUST, deduction, 0);
 	context->cycles -= deduction;
 	if (context->pending_vint_start >= deduction) {
 		context->pending_vint_start -= deduction;
@@ -5825,6 +6526,7 @@ void vdp_deserialize(deserialize_buffer *buf, void *vcontext)
 		warning("Save state has VDP version %d, but this build only understands versions %d and lower", version, VDP_STATE_VERSION);
 	}
 	load_buffer8(buf, context->vdpmem, (vramk * 1024) <= VRAM_SIZE ? vramk * 1024 : VRAM_SIZE);
+	vdp_invalidate_tile_cache(context);
 	if ((vramk * 1024) > VRAM_SIZE) {
 		buf->cur_pos += (vramk * 1024) - VRAM_SIZE;
 	}
@@ -5963,6 +6665,7 @@ void vdp_deserialize(deserialize_buffer *buf, void *vcontext)
 		context->selected_test_reg = 0;
 	}
 	update_video_params(context);
+	vdp_resync_pipeline(context);
 }
 
 static vdp_context *current_vdp;
@@ -6124,3 +6827,124 @@ void vdp_replay_event(vdp_context *context, uint8_t event, event_reader *reader)
 		break;
 	}
 }
+
+//Runs the worker's copy of the VDP through a batch of recorded inputs
+static void replay_pipeline(void *data, pipeline_entry *entries, uint32_t count)
+{
+	vdp_context *context = data;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		pipeline_entry *entry = entries + i;
+		switch (entry->type)
+		{
+		case PIPELINE_RUN:
+			vdp_run_context_full(context, entry->cycle);
+			break;
+		case PIPELINE_REG:
+			vdp_run_context_full(context, entry->cycle);
+			context->regs[entry->address] = entry->value;
+			if (entry->address == REG_MODE_1 || entry->address == REG_MODE_2 || entry->address == REG_MODE_4) {
+				update_video_params(context);
+			}
+			break;
+		case PIPELINE_TEST_REG:
+			vdp_run_context_full(context, entry->cycle);
+			context->test_regs[entry->address] = entry->value;
+			break;
+		case PIPELINE_ADJUST:
+			vdp_run_context_full(context, entry->cycle);
+			vdp_adjust_cycles(context, entry->address);
+			break;
+		case PIPELINE_SUPPRESS:
+			vdp_run_context_full(context, entry->cycle);
+			context->output_suppressed = entry->value;
+			break;
+		default:
+			//run through the slot the entry was recorded in so it lands at the same point
+			context->replay = entry;
+			vdp_run_context_full(context, entry->cycle + 1);
+			if (context->replay) {
+				//slot layout got out of step with the emulated VDP, a late write beats a lost one
+				if (entry->type != PIPELINE_FRAME) {
+					apply_replay(context, entry);
+				} else if (context->early_frames) {
+					//already signalled when the replica reached its own frame end
+					context->early_frames--;
+				} else if (!entry->value && !headless) {
+					vdp_pipeline_frame_done(context->pipeline);
+				}
+				context->replay = NULL;
+			}
+		}
+	}
+}
+
+void vdp_resync_pipeline(vdp_context *context)
+{
+	if (!context->replica) {
+		return;
+	}
+	vdp_pipeline_drain(context->pipeline);
+	vdp_context *replica = context->replica;
+	flush_output_line(replica);
+	memcpy(replica, context, sizeof(vdp_context) + VRAM_SIZE);
+	//the replica restarts from the emulated VDP's position so completions it signalled ahead of it are void
+	replica->early_frames = 0;
+	vdp_pipeline_reset_frames(context->pipeline);
+	replica->replica = NULL;
+	replica->replaying = 1;
+	replica->replay = NULL;
+	replica->output = context->pipeline_output;
+	replica->pipeline_output = replica->pipeline_scratch = NULL;
+	if (context->done_composite) {
+		replica->done_composite = replica->compositebuf + (context->done_composite - context->compositebuf);
+	}
+	stage_output(replica);
+	load_staged_output(replica);
+	//memory writes and DMA are driven by the emulated VDP
+	replica->fifo_read = -1;
+	replica->flags &= ~FLAG_DMA_RUN;
+	replica->dma_hook = NULL;
+	replica->reg_hook = NULL;
+	replica->data_hook = NULL;
+	replica->kmod_msg_buffer = NULL;
+	replica->kmod_buffer_storage = replica->kmod_buffer_length = 0;
+	replica->enabled_debuggers = 0;
+}
+
+void vdp_enable_pipeline(vdp_context *context, uint8_t enabled)
+{
+	if (!enabled == !context->replica) {
+		return;
+	}
+	if (enabled) {
+		vdp_context *replica = calloc(1, sizeof(vdp_context) + VRAM_SIZE);
+		context->pipeline = vdp_pipeline_start(replay_pipeline, replica, MCLKS_LINE * 16);
+		if (!context->pipeline) {
+			warning("Failed to start VDP render thread, rendering on the emulation thread instead\n");
+			free(replica);
+			return;
+		}
+		context->replica = replica;
+		context->pipeline_scratch = malloc(LINEBUF_SIZE * sizeof(uint32_t));
+		if (context->fb_line) {
+			//the replica stages its own output
+			uint32_t *line = (uint32_t *)context->fb_line;
+			flush_output_line(context);
+			context->output = line;
+		}
+		defer_output(context);
+		vdp_resync_pipeline(context);
+	} else {
+		vdp_pipeline_stop(context->pipeline);
+		flush_output_line(context->replica);
+		context->output = context->pipeline_output;
+		stage_output(context);
+		load_staged_output(context);
+		free(context->replica);
+		free(context->pipeline_scratch);
+		context->pipeline = NULL;
+		context->replica = NULL;
+		context->pipeline_output = context->pipeline_scratch = NULL;
+	}
+}
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include "system.h"
 #include "serialize.h"
+#include "vdp_pipeline.h"
 
 #define VDP_REGS 24
 #define CRAM_SIZE 64
@@ -31,6 +32,7 @@
 #define MAX_SPRITES_FRAME 80
 #define MAX_SPRITES_FRAME_H32 64
 #define SAT_CACHE_SIZE (MAX_SPRITES_FRAME * 4)
+#define TILE_ROWS (VRAM_SIZE / 4)
 
 #define CRAM_BITS 0xEEE
 #define VSRAM_BITS 0x7FF
@@ -192,6 +194,17 @@ struct vdp_context {
 	vdp_hook       dma_hook;
 	vdp_reg_hook   reg_hook;
 	vdp_data_hook  data_hook;
+	//set when compositing and output are deferred to a worker thread
+	vdp_pipeline   *pipeline;
+	//copy of this VDP run by the pipeline worker, NULL on the copy itself
+	vdp_context    *replica;
+	//write the replica applies in the external slot it was recorded in
+	pipeline_entry *replay;
+	//framebuffer line the replica draws to, output points at a scratch line when deferred
+	uint32_t       *pipeline_output;
+	uint32_t       *pipeline_scratch;
+	//framebuffer line line_stage gets converted into when the framebuffer isn't 32bpp
+	uint8_t        *fb_line;
 	uint32_t       kmod_buffer_storage;
 	uint32_t       kmod_buffer_length;
 	uint32_t       timer_start_cycle;
@@ -229,9 +242,16 @@ struct vdp_context {
 	uint16_t       hscroll_b_fine;
 	uint16_t       h40_lines;
 	uint16_t       output_lines;
+	uint16_t       mark_h40_lines;
+	uint16_t       mark_output_lines;
 	sprite_draw    sprite_draw_list[MAX_SPRITES_LINE];
 	sprite_info    sprite_info_list[MAX_SPRITES_LINE];
 	uint8_t        sat_cache[SAT_CACHE_SIZE];
+	//4bpp tile rows expanded to one byte per pixel, decoded from vdpmem on first use after a write
+	uint64_t       tile_rows[TILE_ROWS];
+	uint32_t       tile_dirty[TILE_ROWS / 32];
+	//pixels are always rendered at 32bpp, output points here when the framebuffer format is narrower
+	uint32_t       line_stage[LINEBUF_SIZE];
 	uint16_t       col_1;
 	uint16_t       col_2;
 	uint16_t       hv_latch;
@@ -265,11 +285,16 @@ struct vdp_context {
 	uint8_t        debug_fb_indices[NUM_DEBUG_TYPES];
 	uint8_t        debug_modes[NUM_DEBUG_TYPES];
 	uint8_t        pushed_frame;
+	uint8_t        output_suppressed; //current frame is discarded rather than presented
+	uint8_t        mark_pushed_frame;
 	uint8_t        type;
 	uint8_t        cram_latch;
 	uint8_t        window_h_latch;
 	uint8_t        window_v_latch;
 	uint8_t        selected_test_reg;
+	uint8_t        replaying; //this is a replica run by a pipeline worker
+	uint8_t        early_frames; //frames the replica finished before reaching their PIPELINE_FRAME entry
+	uint8_t        fb_format;
 	int32_t        color_map[1 << 12];
 	uint8_t        vdpmem[];
 };
@@ -312,14 +337,20 @@ void vdp_check_update_sat_byte(vdp_context *context, uint32_t address, uint8_t v
 void vdp_pbc_pause(vdp_context *context);
 void vdp_release_framebuffer(vdp_context *context);
 void vdp_reacquire_framebuffer(vdp_context *context);
+void vdp_set_output_suppressed(vdp_context *context, uint8_t suppressed);
+void vdp_mark_output_position(vdp_context *context);
+void vdp_restore_output_position(vdp_context *context);
 void vdp_serialize(vdp_context *context, serialize_buffer *buf);
 void vdp_deserialize(deserialize_buffer *buf, void *vcontext);
 void vdp_force_update_framebuffer(vdp_context *context);
 void vdp_toggle_debug_view(vdp_context *context, uint8_t debug_type);
+void vdp_enable_pipeline(vdp_context *context, uint8_t enabled);
+void vdp_resync_pipeline(vdp_context *context);
+void vdp_invalidate_tile_cache(vdp_context *context);
 void vdp_inc_debug_mode(vdp_context *context);
 //to be implemented by the host system
-uint16_t read_dma_value(uint32_t address);
-void vdp_dma_started(void);
+uint16_t read_dma_value(system_header *system, uint32_t address);
+void vdp_dma_started(system_header *system);
 void vdp_replay_event(vdp_context *context, uint8_t event, event_reader *reader);
 uint16_t vdp_status(vdp_context *context);
 void vdp_reg_write(vdp_context *context, uint16_t reg, uint16_t value);
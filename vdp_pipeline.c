@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include "vdp_pipeline.h"
+
+#define PIPELINE_SIZE 8192
+#define PIPELINE_MASK (PIPELINE_SIZE - 1)
+//entries are handed to the worker in batches so the emulation thread isn't taking the lock on every write
+#define PUBLISH_THRESHOLD 512
+
+static void *pipeline_worker(void *data)
+{
+	vdp_pipeline *pipe = data;
+	pthread_mutex_lock(&pipe->lock);
+	for (;;)
+	{
+		while (pipe->read_pos == pipe->published && !pipe->quit)
+		{
+			pthread_cond_wait(&pipe->work_cond, &pipe->lock);
+		}
+		if (pipe->read_pos == pipe->published) {
+			break;
+		}
+		uint32_t start = pipe->read_pos, end = pipe->published;
+		pthread_mutex_unlock(&pipe->lock);
+		while (start != end)
+		{
+			uint32_t index = start & PIPELINE_MASK;
+			uint32_t count = end - start;
+			if (index + count > PIPELINE_SIZE) {
+				count = PIPELINE_SIZE - index;
+			}
+			pipe->handler(pipe->data, pipe->entries + index, count);
+			start += count;
+		}
+		pthread_mutex_lock(&pipe->lock);
+		__atomic_store_n(&pipe->read_pos, end, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&pipe->done_cond);
+	}
+	pthread_mutex_unlock(&pipe->lock);
+	return NULL;
+}
+
+vdp_pipeline *vdp_pipeline_start(pipeline_handler handler, void *data, uint32_t batch_cycles)
+{
+	vdp_pipeline *pipe = calloc(1, sizeof(vdp_pipeline));
+	pipe->handler = handler;
+	pipe->data = data;
+	pipe->batch_cycles = batch_cycles;
+	pipe->entries = malloc(PIPELINE_SIZE * sizeof(pipeline_entry));
+	pthread_mutex_init(&pipe->lock, NULL);
+	pthread_cond_init(&pipe->work_cond, NULL);
+	pthread_cond_init(&pipe->done_cond, NULL);
+	if (pthread_create(&pipe->thread, NULL, pipeline_worker, pipe)) {
+		pthread_cond_destroy(&pipe->done_cond);
+		pthread_cond_destroy(&pipe->work_cond);
+		pthread_mutex_destroy(&pipe->lock);
+		free(pipe->entries);
+		free(pipe);
+		return NULL;
+	}
+	return pipe;
+}
+
+void vdp_pipeline_stop(vdp_pipeline *pipe)
+{
+	pthread_mutex_lock(&pipe->lock);
+	pipe->published = pipe->write_pos;
+	pipe->quit = 1;
+	pthread_cond_broadcast(&pipe->work_cond);
+	pthread_mutex_unlock(&pipe->lock);
+	pthread_join(pipe->thread, NULL);
+	pthread_cond_destroy(&pipe->done_cond);
+	pthread_cond_destroy(&pipe->work_cond);
+	pthread_mutex_destroy(&pipe->lock);
+	free(pipe->entries);
+	free(pipe);
+}
+
+static void publish(vdp_pipeline *pipe, uint32_t cycle)
+{
+	pipe->publish_cycle = cycle;
+	if (pipe->published == pipe->write_pos) {
+		return;
+	}
+	pthread_mutex_lock(&pipe->lock);
+	pipe->published = pipe->write_pos;
+	pthread_cond_broadcast(&pipe->work_cond);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+void vdp_pipeline_push(vdp_pipeline *pipe, uint8_t type, uint32_t cycle, uint32_t address, uint16_t value)
+{
+	if (pipe->write_pos - __atomic_load_n(&pipe->read_pos, __ATOMIC_ACQUIRE) == PIPELINE_SIZE) {
+		publish(pipe, cycle);
+		pthread_mutex_lock(&pipe->lock);
+		while (pipe->write_pos - pipe->read_pos == PIPELINE_SIZE)
+		{
+			pthread_cond_wait(&pipe->done_cond, &pipe->lock);
+		}
+		pthread_mutex_unlock(&pipe->lock);
+	}
+	pipeline_entry *entry = pipe->entries + (pipe->write_pos & PIPELINE_MASK);
+	entry->cycle = cycle;
+	entry->address = address;
+	entry->value = value;
+	entry->type = type;
+	pipe->write_pos++;
+	if (pipe->write_pos - pipe->published >= PUBLISH_THRESHOLD) {
+		publish(pipe, cycle);
+	}
+}
+
+void vdp_pipeline_run(vdp_pipeline *pipe, uint32_t cycle)
+{
+	pipeline_entry *last = pipe->entries + ((pipe->write_pos - 1) & PIPELINE_MASK);
+	if (pipe->write_pos != pipe->published && last->type == PIPELINE_RUN) {
+		//nothing happened since the last run that hasn't been handed over yet, just extend it
+		last->cycle = cycle;
+	} else {
+		vdp_pipeline_push(pipe, PIPELINE_RUN, cycle, 0, 0);
+	}
+	//cycle counts are rebased every frame so a backwards step also needs a publish
+	if (cycle - pipe->publish_cycle >= pipe->batch_cycles || cycle < pipe->publish_cycle) {
+		publish(pipe, cycle);
+	}
+}
+
+void vdp_pipeline_drain(vdp_pipeline *pipe)
+{
+	publish(pipe, pipe->publish_cycle);
+	pthread_mutex_lock(&pipe->lock);
+	while (pipe->read_pos != pipe->published)
+	{
+		pthread_cond_wait(&pipe->done_cond, &pipe->lock);
+	}
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+void vdp_pipeline_wait_frame(vdp_pipeline *pipe)
+{
+	publish(pipe, pipe->publish_cycle);
+	pthread_mutex_lock(&pipe->lock);
+	while (!pipe->frames_done)
+	{
+		pthread_cond_wait(&pipe->done_cond, &pipe->lock);
+	}
+	//completions are counted so each wait consumes exactly one frame
+	pipe->frames_done--;
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+void vdp_pipeline_frame_done(vdp_pipeline *pipe)
+{
+	pthread_mutex_lock(&pipe->lock);
+	pipe->frames_done++;
+	pthread_cond_broadcast(&pipe->done_cond);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+//Discards completions that haven't been waited for, the pipeline must be drained
+void vdp_pipeline_reset_frames(vdp_pipeline *pipe)
+{
+	pthread_mutex_lock(&pipe->lock);
+	pipe->frames_done = 0;
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+void vdp_pipeline_give_framebuffer(vdp_pipeline *pipe, uint32_t *fb, uint32_t pitch)
+{
+	pthread_mutex_lock(&pipe->lock);
+	pipe->framebuffer = fb;
+	pipe->framebuffer_pitch = pitch;
+	pipe->framebuffer_ready = 1;
+	pthread_cond_broadcast(&pipe->work_cond);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+//Returns NULL if the pipeline is shutting down and no framebuffer will be handed over
+uint32_t *vdp_pipeline_take_framebuffer(vdp_pipeline *pipe, uint32_t *pitch)
+{
+	pthread_mutex_lock(&pipe->lock);
+	while (!pipe->framebuffer_ready && !pipe->quit)
+	{
+		pthread_cond_wait(&pipe->work_cond, &pipe->lock);
+	}
+	if (!pipe->framebuffer_ready) {
+		pthread_mutex_unlock(&pipe->lock);
+		return NULL;
+	}
+	pipe->framebuffer_ready = 0;
+	uint32_t *fb = pipe->framebuffer;
+	*pitch = pipe->framebuffer_pitch;
+	pthread_mutex_unlock(&pipe->lock);
+	return fb;
+}
@@ -0,0 +1,62 @@
+#ifndef VDP_PIPELINE_H_
+#define VDP_PIPELINE_H_
+
+#include <stdint.h>
+#include <pthread.h>
+
+enum {
+	PIPELINE_RUN,
+	PIPELINE_REG,
+	PIPELINE_TEST_REG,
+	PIPELINE_ADJUST,
+	PIPELINE_SUPPRESS,
+	//everything below takes effect inside the slot it was recorded in
+	PIPELINE_VRAM_WORD,
+	PIPELINE_VRAM_BYTE,
+	PIPELINE_VRAM_COPY,
+	PIPELINE_CRAM,
+	PIPELINE_VSRAM,
+	PIPELINE_FRAME
+};
+
+typedef struct {
+	uint32_t cycle;
+	uint32_t address;
+	uint16_t value;
+	uint8_t  type;
+} pipeline_entry;
+
+typedef void (*pipeline_handler)(void *data, pipeline_entry *entries, uint32_t count);
+
+typedef struct {
+	pipeline_handler handler;
+	void             *data;
+	pipeline_entry   *entries;
+	uint32_t         *framebuffer;
+	uint32_t         framebuffer_pitch;
+	uint32_t         write_pos;
+	uint32_t         published;
+	uint32_t         read_pos;
+	uint32_t         publish_cycle;
+	uint32_t         batch_cycles;
+	pthread_t        thread;
+	pthread_mutex_t  lock;
+	pthread_cond_t   work_cond;
+	pthread_cond_t   done_cond;
+	uint32_t         frames_done;
+	uint8_t          framebuffer_ready;
+	uint8_t          quit;
+} vdp_pipeline;
+
+vdp_pipeline *vdp_pipeline_start(pipeline_handler handler, void *data, uint32_t batch_cycles);
+void vdp_pipeline_stop(vdp_pipeline *pipe);
+void vdp_pipeline_push(vdp_pipeline *pipe, uint8_t type, uint32_t cycle, uint32_t address, uint16_t value);
+void vdp_pipeline_run(vdp_pipeline *pipe, uint32_t cycle);
+void vdp_pipeline_drain(vdp_pipeline *pipe);
+void vdp_pipeline_wait_frame(vdp_pipeline *pipe);
+void vdp_pipeline_frame_done(vdp_pipeline *pipe);
+void vdp_pipeline_reset_frames(vdp_pipeline *pipe);
+void vdp_pipeline_give_framebuffer(vdp_pipeline *pipe, uint32_t *fb, uint32_t pitch);
+uint32_t *vdp_pipeline_take_framebuffer(vdp_pipeline *pipe, uint32_t *pitch);
+
+#endif //VDP_PIPELINE_H_
@@ -37,6 +37,7 @@
 #define BIT_STATUS_TIMERB 0x2
 
 static uint32_t ym_calc_phase_inc(ym2612_context * context, ym_operator * operator, uint32_t op);
+static void ym_write_reg(ym2612_context * context, uint8_t value);
 
 static int16_t ams_shift[] = {8, 1, -1, -2};
 static uint8_t lfo_timer_values[] = {108, 77, 71, 67, 62, 44, 8, 5};
@@ -69,6 +70,10 @@ void ym_adjust_master_clock(ym2612_context * context, uint32_t master_clock)
 
 void ym_adjust_cycles(ym2612_context *context, uint32_t deduction)
 {
+	if (context->synth) {
+		ym_flush_deferred(context);
+		ym_adjust_cycles(context->synth, deduction);
+	}
 	context->current_cycle -= deduction;
 	if (context->write_cycle != CYCLE_NEVER && context->write_cycle >= deduction) {
 		context->write_cycle -= deduction;
@@ -91,8 +96,13 @@ void ym_adjust_cycles(ym2612_context *context, uint32_t deduction)
 #define TIMER_A_MAX 1023
 #define TIMER_B_MAX 255
 
+static void ym_clone_synth(ym2612_context *context);
+
 void ym_reset(ym2612_context *context)
 {
+	if (context->synth) {
+		ym_flush_deferred(context);
+	}
 	memset(context->part1_regs, 0, sizeof(context->part1_regs));
 	memset(context->part2_regs, 0, sizeof(context->part2_regs));
 	memset(context->operators, 0, sizeof(context->operators));
@@ -134,6 +144,9 @@ void ym_reset(ym2612_context *context)
 		context->operators[i].envelope = MAX_ENVELOPE;
 		context->operators[i].env_phase = PHASE_RELEASE;
 	}
+	if (context->synth) {
+		ym_clone_synth(context);
+	}
 }
 
 void ym_init(ym2612_context * context, uint32_t master_clock, uint32_t clock_div, uint32_t options)
@@ -178,6 +191,10 @@ void ym_init(ym2612_context * context, uint32_t master_clock, uint32_t clock_div
 
 void ym_free(ym2612_context *context)
 {
+	if (context->synth) {
+		free(context->synth);
+		free(context->write_queue);
+	}
 	render_free_source(context->audio);
 	if (context == log_context) {
 		ym_finalize_log();
@@ -196,6 +213,10 @@ void ym_enable_zero_offset(ym2612_context *context, uint8_t enabled)
 		context->volume_mult = 2;
 		context->volume_div = 3;
 	}
+	if (context->synth) {
+		ym_flush_deferred(context);
+		ym_enable_zero_offset(context->synth, enabled);
+	}
 }
 #define YM_MOD_SHIFT 1
 
@@ -350,116 +371,116 @@ void ym_run_envelope(ym2612_context *context, ym_channel *channel, ym_operator *
 	}
 }
 
-void ym_run_phase(ym2612_context *context, uint32_t channel, uint32_t op)
+static uint16_t ym_am_attenuation(ym2612_context *context, ym_channel *chan)
 {
-	if (channel != 5 || !context->dac_enable) {
-		//printf("updating operator %d of channel %d\n", op, channel);
-		ym_operator * operator = context->operators + op;
-		ym_channel * chan = context->channels + channel;
-		uint16_t phase = operator->phase_counter >> 10 & 0x3FF;
-		uint32_t old_phase = operator->phase_counter;
-		operator->phase_counter += operator->phase_inc;//ym_calc_phase_inc(context, operator, op);
-		operator->phase_overflow = (old_phase & 0xFFFFF) > (operator->phase_counter & 0xFFFFF);
-		int16_t mod = 0;
-		if (op & 3) {
-			if (operator->mod_src[0]) {
-				mod = *operator->mod_src[0];
-				if (operator->mod_src[1]) {
-					mod += *operator->mod_src[1];
-				}
-				mod >>= YM_MOD_SHIFT;
-			}
-		} else {
-			if (chan->feedback) {
-				mod = (chan->op1_old + operator->output) >> (10-chan->feedback);
+	uint16_t base_am = (context->lfo_am_step & 0x80 ? context->lfo_am_step : ~context->lfo_am_step) & 0x7E;
+	if (ams_shift[chan->ams] >= 0) {
+		return (base_am >> ams_shift[chan->ams]) & MAX_ENVELOPE;
+	} else {
+		return base_am << (-ams_shift[chan->ams]);
+	}
+}
+
+//Handles SSG-EG repeat/alternate/hold behavior for an operator whose phase was just advanced
+//returns the envelope value to use for this update
+static uint16_t ym_ssg_update(ym_operator *operator, ym_channel *chan, uint16_t *phase)
+{
+	uint16_t env = operator->envelope;
+	if (env >= SSG_CENTER) {
+		if (operator->ssg & SSG_ALTERNATE) {
+			if (operator->env_phase != PHASE_RELEASE && (
+				!(operator->ssg & SSG_HOLD) || ((operator->ssg ^ operator->inverted) & SSG_INVERT) == 0
+			)) {
+				operator->inverted ^= SSG_INVERT;
 			}
+		} else if (!(operator->ssg & SSG_HOLD)) {
+			*phase = operator->phase_counter = 0;
 		}
-		uint16_t env = operator->envelope;
-		if (operator->ssg) {
-			if (env >= SSG_CENTER) {
-				if (operator->ssg & SSG_ALTERNATE) {
-					if (operator->env_phase != PHASE_RELEASE && (
-						!(operator->ssg & SSG_HOLD) || ((operator->ssg ^ operator->inverted) & SSG_INVERT) == 0
-					)) {
-						operator->inverted ^= SSG_INVERT;
-					}
-				} else if (!(operator->ssg & SSG_HOLD)) {
-					phase = operator->phase_counter = 0;
-				}
-				if (
-					(operator->env_phase == PHASE_DECAY || operator->env_phase == PHASE_SUSTAIN)
-					&& !(operator->ssg & SSG_HOLD)
-				) {
-					start_envelope(operator, chan);
-					env = operator->envelope;
-				}
-			}
-			if (operator->inverted) {
-				env = (SSG_CENTER - env) & MAX_ENVELOPE;
-			}
+		if (
+			(operator->env_phase == PHASE_DECAY || operator->env_phase == PHASE_SUSTAIN)
+			&& !(operator->ssg & SSG_HOLD)
+		) {
+			start_envelope(operator, chan);
+			env = operator->envelope;
 		}
-		env += operator->total_level;
-		if (operator->am) {
-			uint16_t base_am = (context->lfo_am_step & 0x80 ? context->lfo_am_step : ~context->lfo_am_step) & 0x7E;
-			if (ams_shift[chan->ams] >= 0) {
-				env += (base_am >> ams_shift[chan->ams]) & MAX_ENVELOPE;
-			} else {
-				env += base_am << (-ams_shift[chan->ams]);
+	}
+	if (operator->inverted) {
+		env = (SSG_CENTER - env) & MAX_ENVELOPE;
+	}
+	return env;
+}
+
+static int16_t ym_op_modulation(ym_operator *operator, ym_channel *chan, uint32_t op)
+{
+	int16_t mod = 0;
+	if (op & 3) {
+		if (operator->mod_src[0]) {
+			mod = *operator->mod_src[0];
+			if (operator->mod_src[1]) {
+				mod += *operator->mod_src[1];
 			}
+			mod >>= YM_MOD_SHIFT;
 		}
-		if (env > MAX_ENVELOPE) {
-			env = MAX_ENVELOPE;
+	} else {
+		if (chan->feedback) {
+			mod = (chan->op1_old + operator->output) >> (10-chan->feedback);
 		}
-		int16_t output = ym_sine(phase, mod, env);
-		if (op % 4 == 0) {
-			chan->op1_old = operator->output;
-		} else if (op % 4 == 2) {
-			chan->op2_old = operator->output;
+	}
+	return mod;
+}
+
+//Updates the channel output once all 4 of its operators have been updated
+static void ym_update_channel_output(ym2612_context *context, uint32_t channel)
+{
+	ym_channel *chan = context->channels + channel;
+	ym_operator *operator = context->operators + channel * 4 + 3;
+	if (chan->algorithm < 4) {
+		chan->output = operator->output & ~0x1F;
+		chan->phase_overflow = operator->phase_overflow;
+	} else if(chan->algorithm == 4) {
+		ym_operator *other_op = context->operators + channel * 4 + 2;
+		chan->output = (operator->output & ~0x1F) + (other_op->output & ~0x1F);
+		if (chan->output > 0x1FE0) {
+			chan->output = 0x1FE0;
+		} else if (chan->output < -0x1FF0) {
+			chan->output = - 0x1FF0;
 		}
-		operator->output = output;
-		//Update the channel output if we've updated all operators
-		if (op % 4 == 3) {
-			if (chan->algorithm < 4) {
-				chan->output = operator->output & ~0x1F;
-				chan->phase_overflow = operator->phase_overflow;
-			} else if(chan->algorithm == 4) {
-				ym_operator *other_op = context->operators + channel * 4 + 2;
-				chan->output = (operator->output & ~0x1F) + (other_op->output & ~0x1F);
-				if (chan->output > 0x1FE0) {
-					chan->output = 0x1FE0;
-				} else if (chan->output < -0x1FF0) {
-					chan->output = - 0x1FF0;
-				}
-				if (operator->phase_inc < other_op->phase_inc) {
-					chan->phase_overflow = operator->phase_overflow;
-				} else {
-					chan->phase_overflow = other_op->phase_overflow;
-				}
-			} else {
-				output = 0;
-				uint32_t lowest_phase_inc = 0xFFFFFFFF;
-				for (uint32_t op = ((chan->algorithm == 7) ? 0 : 1) + channel*4; op < (channel+1)*4; op++) {
-					output += context->operators[op].output & ~0x1F;
-					if (output > 0x1FE0) {
-						output = 0x1FE0;
-					} else if (output < -0x1FF0) {
-						output = - 0x1FF0;
-					}
-					if (context->operators[op].phase_inc < lowest_phase_inc) {
-						lowest_phase_inc = context->operators[op].phase_inc;
-						chan->phase_overflow = context->operators[op].phase_overflow;
-					}
-				}
-				chan->output = output;
+		if (operator->phase_inc < other_op->phase_inc) {
+			chan->phase_overflow = operator->phase_overflow;
+		} else {
+			chan->phase_overflow = other_op->phase_overflow;
+		}
+	} else {
+		int16_t output = 0;
+		uint32_t lowest_phase_inc = 0xFFFFFFFF;
+		for (uint32_t op = ((chan->algorithm == 7) ? 0 : 1) + channel*4; op < (channel+1)*4; op++) {
+			output += context->operators[op].output & ~0x1F;
+			if (output > 0x1FE0) {
+				output = 0x1FE0;
+			} else if (output < -0x1FF0) {
+				output = - 0x1FF0;
+			}
+			if (context->operators[op].phase_inc < lowest_phase_inc) {
+				lowest_phase_inc = context->operators[op].phase_inc;
+				chan->phase_overflow = context->operators[op].phase_overflow;
 			}
 		}
-		//puts("operator update done");
+		chan->output = output;
 	}
 }
 
+//volume_div is only ever one of two values, dividing by a constant lets the compiler
+//replace the divide with a multiply
+static int16_t ym_scale_volume(ym2612_context *context, int32_t value, int32_t div)
+{
+	value *= context->volume_mult;
+	return context->volume_div == 120 ? value / (120 * div) : value / (3 * div);
+}
+
 void ym_output_sample(ym2612_context *context)
 {
 	int16_t left = 0, right = 0;
+	int16_t offset = ym_scale_volume(context, context->zero_offset, 1);
 	for (int i = 0; i < OPN2_NUM_CHANNELS; i++) {
 		int16_t value = context->channels[i].output;
 		if (value >= 0) {
@@ -475,64 +496,137 @@ void ym_output_sample(ym2612_context *context)
 			scope_add_sample(context->scope, context->channels[i].scope_channel, value, context->channels[i].phase_overflow);
 		}
 #endif
-		if (context->channels[i].lr & 0x80) {
-			left += (value * context->volume_mult) / context->volume_div;
-		} else if (context->zero_offset) {
-			if (value >= 0) {
-				left += (context->zero_offset * context->volume_mult) / context->volume_div;
-			} else {
-				left -= (context->zero_offset * context->volume_mult) / context->volume_div;
-			}
-			left += (value * context->volume_mult) / (60 * context->volume_div);
-		}
-		if (context->channels[i].lr & 0x40) {
-			right += (value * context->volume_mult) / context->volume_div;
-		} else if (context->zero_offset) {
-			if (value >= 0) {
-				right += (context->zero_offset * context->volume_mult) / context->volume_div;
-			} else {
-				right -= (context->zero_offset * context->volume_mult) / context->volume_div;
-			}
-			right += (value * context->volume_mult) / (60 * context->volume_div);
+		int16_t full = ym_scale_volume(context, value, 1);
+		//disabled outputs still leak a little bit of signal
+		int16_t muted = 0;
+		if ((context->channels[i].lr & 0xC0) != 0xC0 && context->zero_offset) {
+			muted = (value >= 0 ? offset : -offset) + ym_scale_volume(context, value, 60);
 		}
+		left += context->channels[i].lr & 0x80 ? full : muted;
+		right += context->channels[i].lr & 0x40 ? full : muted;
+	}
+	context->block[context->block_frames * 2] = left;
+	context->block[context->block_frames * 2 + 1] = right;
+	if (++context->block_frames == AUDIO_BLOCK_FRAMES) {
+		render_put_stereo_block(context->audio, context->block, context->block_frames);
+		context->block_frames = 0;
 	}
-	render_put_stereo_sample(context->audio, left, right);
 }
 
-void ym_run(ym2612_context * context, uint32_t to_cycle)
+//Runs operator slots first_op up to (but not including) last_op of the current sample
+//Produces the same result as running the timers, envelope generator and phase generator
+//slot by slot, but each stage is run over the whole range at once with intermediate
+//per-operator values kept in structure-of-arrays scratch buffers
+static void ym_run_slots(ym2612_context *context, uint32_t first_op, uint32_t last_op)
 {
-	if (context->current_cycle >= to_cycle) {
-		return;
+	//Update timers at beginning of 144 cycle period
+	if (!first_op) {
+		ym_run_timers(context);
 	}
-	//printf("Running YM2612 from cycle %d to cycle %d\n", context->current_cycle, to_cycle);
-	//TODO: Fix channel update order OR remap channels in register write
-	for (; context->current_cycle < to_cycle; context->current_cycle += context->clock_inc) {
-		//Update timers at beginning of 144 cycle period
-		if (!context->current_op) {
-			ym_run_timers(context);
-		}
-		//Update Envelope Generator
-		if (!(context->current_op % 3)) {
-			uint32_t op = context->current_env_op;
-			ym_operator * operator = context->operators + op;
-			ym_channel * channel = context->channels + op/4;
-			ym_run_envelope(context, channel, operator);
+	//operators of channel 6 are not updated at all while the DAC is enabled
+	uint32_t phase_end = context->dac_enable && last_op > 5*4 ? 5*4 : last_op;
+	uint16_t phase[OPN2_NUM_OPERATORS];
+	uint16_t atten[OPN2_NUM_OPERATORS];
+	uint16_t am_atten[OPN2_NUM_CHANNELS];
+	for (uint32_t channel = first_op / 4; channel * 4 < phase_end; channel++)
+	{
+		am_atten[channel] = ym_am_attenuation(context, context->channels + channel);
+	}
+
+	//Update Phase Generator
+	for (uint32_t op = first_op; op < phase_end; op++)
+	{
+		ym_operator *operator = context->operators + op;
+		uint32_t old_phase = operator->phase_counter;
+		phase[op] = old_phase >> 10 & 0x3FF;
+		operator->phase_counter = old_phase + operator->phase_inc;
+		operator->phase_overflow = (old_phase & 0xFFFFF) > (operator->phase_counter & 0xFFFFF);
+	}
+
+	//Update Envelope Generator
+	//One operator's envelope is updated every 3rd slot. An update lands before the phase
+	//update of the same slot, so interleaving the two in slot order keeps each operator's
+	//attenuation consistent with the slot-at-a-time behavior
+	uint32_t next_env_slot = (first_op + 2) / 3 * 3;
+	for (uint32_t op = first_op; op < last_op; op++)
+	{
+		if (op == next_env_slot) {
+			next_env_slot += 3;
+			uint32_t env_op = context->current_env_op;
+			ym_run_envelope(context, context->channels + env_op / 4, context->operators + env_op);
 			context->current_env_op++;
 			if (context->current_env_op == OPN2_NUM_OPERATORS) {
 				context->current_env_op = 0;
 				context->env_counter++;
 			}
 		}
+		if (op < phase_end) {
+			ym_operator *operator = context->operators + op;
+			uint16_t env = operator->ssg ? ym_ssg_update(operator, context->channels + op / 4, phase + op) : operator->envelope;
+			env += operator->total_level + (operator->am ? am_atten[op / 4] : 0);
+			atten[op] = env > MAX_ENVELOPE ? MAX_ENVELOPE : env;
+		}
+	}
 
-		//Update Phase Generator
-		ym_run_phase(context, context->current_op / 4, context->current_op);
-		context->current_op++;
-		if (context->current_op == OPN2_NUM_OPERATORS) {
-			context->current_op = 0;
-			ym_output_sample(context);
+	//Operator output
+	for (uint32_t op = first_op; op < phase_end; op++)
+	{
+		ym_operator *operator = context->operators + op;
+		ym_channel *chan = context->channels + op / 4;
+		int16_t output = ym_sine(phase[op], ym_op_modulation(operator, chan, op), atten[op]);
+		if (op % 4 == 0) {
+			chan->op1_old = operator->output;
+		} else if (op % 4 == 2) {
+			chan->op2_old = operator->output;
 		}
+		operator->output = output;
+		//Update the channel output if we've updated all operators
+		if (op % 4 == 3) {
+			ym_update_channel_output(context, op / 4);
+		}
+	}
+	if (last_op == OPN2_NUM_OPERATORS) {
+		ym_output_sample(context);
+	}
+}
 
+void ym_run(ym2612_context * context, uint32_t to_cycle)
+{
+	if (context->current_cycle >= to_cycle) {
+		return;
 	}
+	//printf("Running YM2612 from cycle %d to cycle %d\n", context->current_cycle, to_cycle);
+	uint32_t slots = (to_cycle - context->current_cycle + context->clock_inc - 1) / context->clock_inc;
+	context->current_cycle += slots * context->clock_inc;
+	if (context->synth) {
+		//sound generation happens later in ym_flush_deferred, only the timers need to be kept
+		//in step with the CPUs since they affect the status register
+		while (slots)
+		{
+			if (!context->current_op) {
+				ym_run_timers(context);
+			}
+			uint32_t step = OPN2_NUM_OPERATORS - context->current_op;
+			if (step > slots) {
+				step = slots;
+			}
+			slots -= step;
+			context->current_op = (context->current_op + step) % OPN2_NUM_OPERATORS;
+		}
+		return;
+	}
+	while (slots)
+	{
+		uint32_t last_op = context->current_op + slots;
+		if (last_op > OPN2_NUM_OPERATORS) {
+			last_op = OPN2_NUM_OPERATORS;
+		}
+		ym_run_slots(context, context->current_op, last_op);
+		slots -= last_op - context->current_op;
+		context->current_op = last_op == OPN2_NUM_OPERATORS ? 0 : last_op;
+	}
+	render_put_stereo_block(context->audio, context->block, context->block_frames);
+	context->block_frames = 0;
 	//printf("Done running YM2612 at cycle %d\n", context->current_cycle, to_cycle);
 }
 
@@ -703,6 +797,24 @@ void ym_data_write(ym2612_context * context, uint8_t value)
 	uint8_t buffer[3] = {context->selected_part, context->selected_reg, value};
 	event_log(EVENT_YM_REG, context->current_cycle, sizeof(buffer), buffer);
 	dfprintf(debug_file, "write of %X to reg %X in part %d\n", value, context->selected_reg, context->selected_part+1);
+	if (context->synth) {
+		if (context->queued_writes == YM_DEFERRED_WRITES) {
+			//the owner normally flushes all audio sources together once ym_deferred_full
+			//says so, this only catches writes from elsewhere, like the debugger
+			ym_flush_deferred(context);
+		}
+		context->write_queue[context->queued_writes++] = (ym_queued_write){
+			.cycle = context->current_cycle,
+			.part = context->selected_part,
+			.reg = context->selected_reg,
+			.value = value
+		};
+	}
+	ym_write_reg(context, value);
+}
+
+static void ym_write_reg(ym2612_context * context, uint8_t value)
+{
 	if (context->selected_reg < 0x30) {
 		//Shared regs
 		switch (context->selected_reg)
@@ -1041,6 +1153,7 @@ uint8_t ym_read_status(ym2612_context * context, uint32_t cycle, uint32_t port)
 
 void ym_print_channel_info(ym2612_context *context, int channel)
 {
+	ym_flush_deferred(context);
 	ym_channel *chan = context->channels + channel;
 	printf("\n***Channel %d***\n"
 	       "Algorithm: %d\n"
@@ -1109,6 +1222,7 @@ void ym_print_timer_info(ym2612_context *context)
 
 void ym_serialize(ym2612_context *context, serialize_buffer *buf)
 {
+	ym_flush_deferred(context);
 	save_buffer8(buf, context->part1_regs, YM_PART1_REGS);
 	save_buffer8(buf, context->part2_regs, YM_PART2_REGS);
 	for (int i = 0; i < OPN2_NUM_OPERATORS; i++)
@@ -1159,6 +1273,7 @@ void ym_serialize(ym2612_context *context, serialize_buffer *buf)
 void ym_deserialize(deserialize_buffer *buf, void *vcontext)
 {
 	ym2612_context *context = vcontext;
+	ym_flush_deferred(context);
 	uint8_t temp_regs[YM_PART1_REGS];
 	load_buffer8(buf, temp_regs, YM_PART1_REGS);
 	context->selected_part = 0;
@@ -1237,6 +1352,9 @@ void ym_deserialize(deserialize_buffer *buf, void *vcontext)
 		context->last_status = context->status;
 		context->last_status_cycle = context->write_cycle;
 	}
+	if (context->synth) {
+		ym_clone_synth(context);
+	}
 }
 
 void ym_enable_scope(ym2612_context *context, oscilloscope *scope, uint32_t master_clock)
@@ -1255,5 +1373,106 @@ void ym_enable_scope(ym2612_context *context, oscilloscope *scope, uint32_t mast
 	{
 		context->channels[i].scope_channel = scope_add_channel(scope, names[i], master_clock / (context->clock_inc * OPN2_NUM_OPERATORS));
 	}
+	if (context->synth) {
+		ym_flush_deferred(context);
+		context->synth->scope = scope;
+		for (int i = 0; i < OPN2_NUM_CHANNELS; i++)
+		{
+			context->synth->channels[i].scope_channel = context->channels[i].scope_channel;
+		}
+	}
 #endif
 }
+
+//Operator modulation sources point into the context that owns them
+//so they need to be fixed up when operator state is copied between contexts
+static void ym_rebase_mod_src(ym2612_context *dst, ym2612_context *src)
+{
+	for (int i = 0; i < OPN2_NUM_OPERATORS; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			int16_t *mod_src = dst->operators[i].mod_src[j];
+			if (mod_src) {
+				dst->operators[i].mod_src[j] = (int16_t *)((uint8_t *)dst + ((uint8_t *)mod_src - (uint8_t *)src));
+			}
+		}
+	}
+}
+
+static void ym_clone_synth(ym2612_context *context)
+{
+	ym2612_context *synth = context->synth;
+	memcpy(synth, context, sizeof(*synth));
+	synth->vgm = NULL;
+	synth->synth = NULL;
+	synth->write_queue = NULL;
+	synth->queued_writes = 0;
+	ym_rebase_mod_src(synth, context);
+	context->queued_writes = 0;
+	context->replayed_writes = 0;
+}
+
+void ym_enable_deferred(ym2612_context *context, uint8_t enabled)
+{
+	if (enabled && !context->synth) {
+		context->synth = malloc(sizeof(ym2612_context));
+		context->write_queue = calloc(YM_DEFERRED_WRITES, sizeof(ym_queued_write));
+		ym_clone_synth(context);
+	} else if (!enabled && context->synth) {
+		ym_flush_deferred(context);
+		free(context->synth);
+		free(context->write_queue);
+		context->synth = NULL;
+		context->write_queue = NULL;
+	}
+}
+
+//Renders the synth up to cycle, replaying the queued register writes that happen before it
+void ym_render_deferred(ym2612_context *context, uint32_t cycle)
+{
+	ym2612_context *synth = context->synth;
+	if (!synth) {
+		return;
+	}
+	for (; context->replayed_writes < context->queued_writes; context->replayed_writes++)
+	{
+		ym_queued_write *write = context->write_queue + context->replayed_writes;
+		if (write->cycle > cycle) {
+			break;
+		}
+		ym_run(synth, write->cycle);
+		synth->selected_part = write->part;
+		synth->selected_reg = write->reg;
+		if (write->part) {
+			synth->part2_regs[write->reg - YM_PART2_START] = write->value;
+		} else {
+			synth->part1_regs[write->reg - YM_PART1_START] = write->value;
+		}
+		ym_write_reg(synth, write->value);
+	}
+	ym_run(synth, cycle);
+}
+
+//Renders all queued register writes and brings the operator and channel state of the
+//CPU facing context up to date with the synth
+void ym_flush_deferred(ym2612_context *context)
+{
+	ym2612_context *synth = context->synth;
+	if (!synth) {
+		return;
+	}
+	ym_render_deferred(context, context->current_cycle);
+	context->queued_writes = 0;
+	context->replayed_writes = 0;
+	memcpy(context->operators, synth->operators, sizeof(context->operators));
+	memcpy(context->channels, synth->channels, sizeof(context->channels));
+	ym_rebase_mod_src(context, synth);
+	context->env_counter = synth->env_counter;
+	context->current_env_op = synth->current_env_op;
+}
+
+uint8_t ym_deferred_full(ym2612_context *context)
+{
+	return context->synth && context->queued_writes == YM_DEFERRED_WRITES;
+}
@@ -32,7 +32,18 @@ typedef struct {
 #define YM_PART1_REGS (YM_REG_END-YM_PART1_START)
 #define YM_PART2_REGS (YM_REG_END-YM_PART2_START)
 
+#define YM_DEFERRED_WRITES 1024
+
 typedef struct {
+	uint32_t cycle;
+	uint8_t  part;
+	uint8_t  reg;
+	uint8_t  value;
+} ym_queued_write;
+
+typedef struct ym2612_context ym2612_context;
+
+struct ym2612_context {
 	audio_source *audio;
 	vgm_writer   *vgm;
 	oscilloscope *scope;
@@ -74,7 +85,17 @@ typedef struct {
 	uint8_t      selected_part;
 	uint8_t      part1_regs[YM_PART1_REGS];
 	uint8_t      part2_regs[YM_PART2_REGS];
-} ym2612_context;
+	//when sound generation is deferred, synth does the actual rendering in batches and this
+	//context only runs the timers, which are the only part of the chip visible to the CPUs
+	ym2612_context  *synth;
+	ym_queued_write *write_queue;
+	uint32_t        queued_writes;
+	//number of queued writes the synth has already replayed
+	uint32_t        replayed_writes;
+	//samples produced by ym_run, handed to the audio source in one go
+	uint32_t        block_frames;
+	int16_t         block[AUDIO_BLOCK_FRAMES * 2];
+};
 
 enum {
 	REG_LFO          = 0x22,
@@ -121,6 +142,10 @@ void ym_print_timer_info(ym2612_context *context);
 void ym_serialize(ym2612_context *context, serialize_buffer *buf);
 void ym_deserialize(deserialize_buffer *buf, void *vcontext);
 void ym_enable_scope(ym2612_context *context, oscilloscope *scope, uint32_t master_clock);
+void ym_enable_deferred(ym2612_context *context, uint8_t enabled);
+void ym_render_deferred(ym2612_context *context, uint32_t cycle);
+void ym_flush_deferred(ym2612_context *context);
+uint8_t ym_deferred_full(ym2612_context *context);
 
 #endif //YM2612_H_
 
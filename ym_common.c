@@ -1,4 +1,5 @@
 #include <math.h>
+#include <pthread.h>
 #include "ym_common.h"
 
 #ifdef __ANDROID__
@@ -48,13 +49,8 @@ static uint16_t round_fixed_point(double value, int dec_bits)
 	return value * (1 << dec_bits) + 0.5;
 }
 
-void ym_init_tables(void)
+static void init_tables(void)
 {
-	static uint8_t did_tbl_init;
-	if (did_tbl_init) {
-		return;
-	}
-	did_tbl_init = 1;
 	//populate sine table
 	for (int32_t i = 0; i < 512; i++) {
 		double sine = sin( ((double)(i*2+1) / SINE_TABLE_SIZE) * M_PI_2 );
@@ -112,6 +108,13 @@ void ym_init_tables(void)
 	}
 }
 
+//tables are shared by all instances, which may be created on different threads
+void ym_init_tables(void)
+{
+	static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+	pthread_once(&tables_once, init_tables);
+}
+
 int16_t ym_sine(uint16_t phase, int16_t mod, uint16_t env)
 {
 	phase += mod;
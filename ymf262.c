@@ -34,15 +34,23 @@ void ymf262_adjust_cycles(ymf262_context *context, uint32_t deduction)
 
 void ymf262_run(ymf262_context *context, uint32_t to_cycle)
 {
+	int16_t block[AUDIO_BLOCK_FRAMES * 2];
+	uint32_t block_frames = 0;
 	for (; context->cycle < to_cycle; context->cycle += context->clock_inc)
 	{
 		context->current_op++;
 		if (context->current_op == OPL3_NUM_OPERATORS) {
 			context->current_op = 0;
 			int16_t left = 0, right = 0;
-			render_put_stereo_sample(context->audio, left, right);
+			block[block_frames * 2] = left;
+			block[block_frames * 2 + 1] = right;
+			if (++block_frames == AUDIO_BLOCK_FRAMES) {
+				render_put_stereo_block(context->audio, block, block_frames);
+				block_frames = 0;
+			}
 		}
 	}
+	render_put_stereo_block(context->audio, block, block_frames);
 }
 
 void ymf262_address_write_part1(ymf262_context *context, uint8_t address)
@@ -2957,7 +2957,12 @@ void z80_map_native_address(z80_context * context, uint32_t address, uint8_t * n
 		map->offsets = malloc(sizeof(int32_t) * NATIVE_CHUNK_SIZE);
 		memset(map->offsets, 0xFF, sizeof(int32_t) * NATIVE_CHUNK_SIZE);
 	}
-	map->offsets[address % NATIVE_CHUNK_SIZE] = native_address - map->base;
+	int32_t native_off = native_address - map->base;
+	if (map->offsets[address % NATIVE_CHUNK_SIZE] != native_off) {
+		//retranslating in place doesn't use any more space
+		opts->gen.translated_bytes += native_size;
+	}
+	map->offsets[address % NATIVE_CHUNK_SIZE] = native_off;
 	for(--size, address++; size; --size, address++) {
 		address &= opts->gen.address_mask;
 		map = opts->gen.native_code_map + address / NATIVE_CHUNK_SIZE;
@@ -3120,6 +3125,8 @@ void * z80_retranslate_inst(uint32_t address, z80_context * context, uint8_t * o
 			}
 		}*/
 		z80_map_native_address(context, address, start, after-inst, ZMAX_NATIVE_SIZE);
+		//the original translation is now just a jump to the new one
+		opts->gen.dead_bytes += orig_size;
 		code_info tmp_code = {orig_start, orig_start + 16};
 		jmp(&tmp_code, start);
 		tmp_code = *code;
@@ -3196,12 +3203,20 @@ void translate_z80_stream(z80_context * context, uint32_t address)
 	} while (opts->gen.deferred);
 }
 
+//interpreter stubs are generated lazily after the flush point so they don't survive a flush
+static void z80_code_flushed(void *vcontext)
+{
+	z80_context *context = vcontext;
+	memset(context->interp_code, 0, sizeof(context->interp_code));
+}
+
 void init_z80_opts(z80_options * options, memmap_chunk const * chunks, uint32_t num_chunks, memmap_chunk const * io_chunks, uint32_t num_io_chunks, uint32_t clock_divider, uint32_t io_address_mask)
 {
 	memset(options, 0, sizeof(*options));
 
 	options->gen.memmap = chunks;
 	options->gen.memmap_chunks = num_chunks;
+	options->gen.code_flushed = z80_code_flushed;
 	options->gen.address_size = SZ_W;
 	options->gen.address_mask = 0xFFFF;
 	options->gen.max_address = 0x10000;
@@ -3429,6 +3444,7 @@ void init_z80_opts(z80_options * options, memmap_chunk const * chunks, uint32_t
 	*no_extra = code->cur - (no_extra + 1);
 	jmp_rind(code, options->gen.context_reg);
 	code->stack_off = tmp_stack_off;
+	set_code_flush_point(&options->gen);
 }
 
 z80_context *init_z80_context(z80_options * options)
@@ -3463,6 +3479,13 @@ void z80_run(z80_context * context, uint32_t target_cycle)
 			//we can approximate that by running for a single m-cycle after a bus request
 			context->sync_cycle = context->busreq ? context->current_cycle + 3*context->options->gen.clock_divider : target_cycle;
 			if (!context->native_pc) {
+				//nothing points into translated code when there's no native PC (after a reset for instance)
+				//so this is where the translation cache can be thrown away safely
+				z80_options *opts = context->options;
+				if (!context->extra_pc && code_flush_needed(&opts->gen)) {
+					debug_message("Flushing Z80 code cache, %u of %u KB dead\n", opts->gen.dead_bytes / 1024, opts->gen.translated_bytes / 1024);
+					flush_code(&opts->gen, context, NATIVE_MAP_CHUNKS);
+				}
 				context->native_pc = z80_get_native_address_trans(context, context->pc);
 			}
 			while (context->current_cycle < context->sync_cycle)
@@ -3507,6 +3530,7 @@ void z80_options_free(z80_options *opts)
 		free(opts->gen.ram_inst_sizes[i]);
 	}
 	free(opts->gen.ram_inst_sizes);
+	free_code_pool(&opts->gen.code);
 	free(opts);
 }
 
@@ -3667,6 +3691,8 @@ void zcreate_stub(z80_context * context)
 	add_ir(code, check_int_size - patch_size, opts->gen.scratch1, SZ_PTR);
 	jmp_r(code, opts->gen.scratch1);
 	code->stack_off = start_stack_off;
+	//a flush must not reclaim the stub that breakpoint patches call into
+	set_code_flush_point(&opts->gen);
 }
 
 void z80_clock_divider_updated(z80_options *options)
@@ -3873,6 +3899,8 @@ void z80_clock_divider_updated(z80_options *options)
 	//TODO: Check if we can get away with TCO here
 	call(code, options->write_8_noinc);
 	retn(code);
+	//the new helpers need to survive a flush of the translation cache
+	set_code_flush_point(&options->gen);
 }
 
 void zinsert_breakpoint(z80_context * context, uint16_t address, uint8_t * bp_handler)
@@ -3955,6 +3983,8 @@ static void z80_enable_watchpoints(z80_context *context)
 	};
 	jmp(&code, new_write8);
 	context->options->write_8 = new_write8;
+	//the new handler needs to survive a flush of the translation cache
+	set_code_flush_point(&context->options->gen);
 }
 
 void z80_add_watchpoint(z80_context *context, uint16_t address, uint16_t size)